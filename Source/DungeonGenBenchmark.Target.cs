@@ -0,0 +1,25 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+using UnrealBuildTool;
+using System.Collections.Generic;
+
+[SupportedPlatforms(UnrealPlatformClass.Desktop)]
+public class DungeonGenBenchmarkTarget : TargetRules
+{
+	public DungeonGenBenchmarkTarget(TargetInfo Target) : base(Target)
+	{
+		Type = TargetType.Program;
+		LinkType = TargetLinkType.Monolithic;
+		DefaultBuildSettings = BuildSettingsVersion.V2;
+		LaunchModuleName = "DungeonGenBenchmark";
+
+		// Headless console program, only Core is needed to run the generators
+		bBuildDeveloperTools = false;
+		bCompileAgainstEngine = false;
+		bCompileAgainstCoreUObject = false;
+		bCompileAgainstApplicationCore = false;
+		bCompileICU = false;
+		bUseLoggingInShipping = true;
+		bIsBuildingConsoleApplication = true;
+	}
+}
@@ -0,0 +1,15 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+using System.IO;
+using UnrealBuildTool;
+
+public class DungeonGenBenchmark : ModuleRules
+{
+	public DungeonGenBenchmark(ReadOnlyTargetRules Target) : base(Target)
+	{
+		PublicIncludePaths.Add(Path.Combine(EngineDirectory, "Source/Runtime/Launch/Public"));
+		PrivateIncludePaths.Add(Path.Combine(EngineDirectory, "Source/Runtime/Launch/Private"));
+
+		PrivateDependencyModuleNames.AddRange(new string[] { "Core", "Projects", "DungeonGenerationCore" });
+	}
+}
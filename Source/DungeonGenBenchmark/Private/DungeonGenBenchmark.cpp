@@ -0,0 +1,402 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "RequiredProgramMainCPPInclude.h"
+#include "BSPDungeonGenerator.h"
+#include "RRPDungeonGenerator.h"
+#include "DungeonChunkLayout.h"
+#include "DungeonLayoutFile.h"
+#include "DungeonLayoutCache.h"
+#include "Misc/Paths.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogDungeonGenBenchmark, Log, All);
+
+IMPLEMENT_APPLICATION(DungeonGenBenchmark, "DungeonGenBenchmark");
+
+namespace DungeonGenBenchmark
+{
+	struct FTimings
+	{
+		double Min = DBL_MAX;
+		double Max = 0.0;
+		double Total = 0.0;
+		int Count = 0;
+
+		void Add(double seconds)
+		{
+			Min = FMath::Min(Min, seconds);
+			Max = FMath::Max(Max, seconds);
+			Total += seconds;
+			Count++;
+		}
+	};
+
+	struct FMemoryUsage
+	{
+		SIZE_T Min = SIZE_MAX;
+		SIZE_T Max = 0;
+
+		void Add(SIZE_T bytes)
+		{
+			Min = FMath::Min(Min, bytes);
+			Max = FMath::Max(Max, bytes);
+		}
+	};
+
+	/*Generates the dungeon and collects its meshes, the same work the actors do before spawning the instances.*/
+	double RunBSP(const FBSPDungeonSettings& settings, int& outNrOfMeshes, SIZE_T& outAllocatedSize, FDungeonGenerationReport& outReport)
+	{
+		FDungeonMeshInstances meshes{};
+
+		const double startTime = FPlatformTime::Seconds();
+		FBSPDungeonGenerator generator(settings);
+		generator.GenerateDungeon();
+		const double meshStartTime = FPlatformTime::Seconds();
+		generator.GetMeshInstances(FTransform::Identity, meshes);
+		const double endTime = FPlatformTime::Seconds();
+
+		outNrOfMeshes = meshes.Num();
+		outAllocatedSize = generator.GetAllocatedSize();
+		outReport = generator.GetReport();
+		outReport.AddPhase(TEXT("GetMeshInstances"), (endTime - meshStartTime) * 1000.0);
+		outReport.SetCounter(TEXT("Meshes"), outNrOfMeshes);
+		return endTime - startTime;
+	}
+
+	double RunRRP(const FRRPDungeonSettings& settings, int& outNrOfMeshes, FDungeonGenerationReport& outReport)
+	{
+		FDungeonMeshInstances meshes{};
+
+		const double startTime = FPlatformTime::Seconds();
+		FRRPDungeonGenerator generator(settings);
+		generator.GenerateDungeon();
+		const double meshStartTime = FPlatformTime::Seconds();
+		generator.GetMeshInstances(meshes);
+		const double endTime = FPlatformTime::Seconds();
+
+		outNrOfMeshes = meshes.Num();
+		outReport = generator.GetReport();
+		outReport.AddPhase(TEXT("GetMeshInstances"), (endTime - meshStartTime) * 1000.0);
+		outReport.SetCounter(TEXT("Meshes"), outNrOfMeshes);
+		return endTime - startTime;
+	}
+
+	/*Generates the dungeon and searches all its corridors again with A* and Jump Point Search, returns the number of corridors with a different path cost.*/
+	int RunRRPPathComparison(const FRRPDungeonSettings& settings)
+	{
+		FRRPDungeonGenerator generator(settings);
+		generator.GenerateDungeon();
+		return generator.GetNrOfDifferentPathCosts();
+	}
+
+	/*Generates the dungeon with the first premade room and moves that room 2 tiles, only the update and its meshes are timed.*/
+	double RunRRPUpdate(const FRRPDungeonSettings& settings, FDungeonGenerationReport& outReport)
+	{
+		FRRPDungeonGenerator generator(settings);
+		generator.GenerateDungeon();
+
+		TArray<FRRPRoom> premadeRooms = settings.PremadeRooms;
+		premadeRooms[0].CentralPosition.X += settings.RoomTileSize * 2;
+		FDungeonMeshInstances meshes{};
+		const double startTime = FPlatformTime::Seconds();
+		const bool isUpdated = generator.UpdatePremadeRooms(premadeRooms);
+		if (isUpdated)
+			generator.GetMeshInstancesOfTileNodes(generator.GetDirtyTileNodes(), meshes);
+		const double endTime = FPlatformTime::Seconds();
+
+		outReport = generator.GetReport();
+		outReport.SetCounter(TEXT("Updated"), isUpdated);
+		return endTime - startTime;
+	}
+
+	/*Saves the layout of the dungeon, only mapping the file and building its meshes is timed.
+	outIsSameMeshes is false when the loaded layout gives other meshes than the generator.*/
+	double RunBSPLayout(const FBSPDungeonSettings& settings, const FString& fileName, bool& outIsSameMeshes)
+	{
+		FBSPDungeonGenerator generator(settings);
+		generator.GenerateDungeon();
+		FDungeonMeshInstances generatedMeshes{};
+		generator.GetMeshInstances(FTransform::Identity, generatedMeshes);
+		FDungeonLayoutFile::SaveToFile(generator, fileName);
+
+		FDungeonMeshInstances loadedMeshes{};
+		const double startTime = FPlatformTime::Seconds();
+		FMappedDungeonLayout layout{};
+		if (layout.Open(fileName))
+			layout.GetMeshInstances(FTransform::Identity, loadedMeshes);
+		const double endTime = FPlatformTime::Seconds();
+
+		outIsSameMeshes = loadedMeshes.Num() == generatedMeshes.Num() && loadedMeshes.WallCustomData == generatedMeshes.WallCustomData;
+		for (int i = 0; outIsSameMeshes && i < loadedMeshes.FloorTransforms.Num(); i++)
+		{
+			outIsSameMeshes = loadedMeshes.FloorTransforms[i].Equals(generatedMeshes.FloorTransforms[i]);
+		}
+		for (int i = 0; outIsSameMeshes && i < loadedMeshes.WallTransforms.Num(); i++)
+		{
+			outIsSameMeshes = loadedMeshes.WallTransforms[i].Equals(generatedMeshes.WallTransforms[i]);
+		}
+		return endTime - startTime;
+	}
+
+	void GetMeshInstances(const FBSPDungeonGenerator& generator, FDungeonMeshInstances& outMeshes)
+	{
+		generator.GetMeshInstances(FTransform::Identity, outMeshes);
+	}
+
+	void GetMeshInstances(const FRRPDungeonGenerator& generator, FDungeonMeshInstances& outMeshes)
+	{
+		generator.GetMeshInstances(outMeshes);
+	}
+
+	/*Looks the dungeon up in the cache and generates and adds it on a miss, the same as the actors with IsUsingLayoutCache.*/
+	template<typename GeneratorType, typename SettingsType>
+	double RunCached(const SettingsType& settings, const FSHAHash& key, FDungeonLayoutCache& cache, bool& outIsHit)
+	{
+		FDungeonMeshInstances meshes{};
+		const double startTime = FPlatformTime::Seconds();
+		outIsHit = cache.Find(key, meshes);
+		if (!outIsHit)
+		{
+			GeneratorType generator(settings);
+			generator.GenerateDungeon();
+			GetMeshInstances(generator, meshes);
+			cache.Add(key, meshes);
+		}
+		return FPlatformTime::Seconds() - startTime;
+	}
+
+	/*True when the door tile is a floor without a wall on the border it is on.*/
+	bool IsDoorOpen(const FBSPDungeonGenerator& generator, const FIntPoint& door, EDungeonObjectAlign border)
+	{
+		const FTile& tile = generator.GetTiles()[door.Y * generator.GetTileRows() + door.X];
+		return tile.tileType != ETileType::EMPTY && !tile.HasWall(border);
+	}
+
+	/*Generates the chunk and its right and top neighbours separately and returns how many of the 2 shared doors are open on both sides.*/
+	int RunChunkSeams(const FBSPDungeonSettings& worldSettings, const FIntPoint& chunk)
+	{
+		FBSPDungeonGenerator generator(FDungeonChunkLayout::GetChunkSettings(worldSettings, chunk));
+		FBSPDungeonGenerator rightGenerator(FDungeonChunkLayout::GetChunkSettings(worldSettings, chunk + FIntPoint(1, 0)));
+		FBSPDungeonGenerator topGenerator(FDungeonChunkLayout::GetChunkSettings(worldSettings, chunk + FIntPoint(0, 1)));
+		generator.GenerateDungeon();
+		rightGenerator.GenerateDungeon();
+		topGenerator.GenerateDungeon();
+
+		//the door order of GetChunkSettings is right, left, top, bottom
+		const TArray<FIntPoint>& doors = generator.GetSettings().DoorTiles;
+		const bool isRightSeamOpen = IsDoorOpen(generator, doors[0], EDungeonObjectAlign::LEFT) && IsDoorOpen(rightGenerator, rightGenerator.GetSettings().DoorTiles[1], EDungeonObjectAlign::RIGHT);
+		const bool isTopSeamOpen = IsDoorOpen(generator, doors[2], EDungeonObjectAlign::TOP) && IsDoorOpen(topGenerator, topGenerator.GetSettings().DoorTiles[3], EDungeonObjectAlign::BOTTOM);
+		return isRightSeamOpen + isTopSeamOpen;
+	}
+}
+
+INT32_MAIN_INT32_ARGC_TCHAR_ARGV()
+{
+	GEngineLoop.PreInit(ArgC, ArgV);
+
+	//Usage: DungeonGenBenchmark -generator=bsp|rrp -count=100 -seed=0 [-rooms=12] [-splits=5] [-splitdepth=0] [-parallel] [-mst] [-window=0] [-parallelpaths] [-jps] [-hpa] [-clustersize=16] [-comparepaths] [-updateroom] [-chunks] [-layout] [-cache] [-cachememorymb=256] [-report=path.csv]
+	const TCHAR* cmdLine = FCommandLine::Get();
+	FString generatorName = TEXT("bsp");
+	FString reportPath{};
+	int count = 100;
+	int seed = 0;
+	FParse::Value(cmdLine, TEXT("-generator="), generatorName);
+	FParse::Value(cmdLine, TEXT("-count="), count);
+	FParse::Value(cmdLine, TEXT("-seed="), seed);
+	FParse::Value(cmdLine, TEXT("-report="), reportPath);
+	count = FMath::Max(count, 1);
+
+	FBSPDungeonSettings bspSettings{};
+	FParse::Value(cmdLine, TEXT("-splits="), bspSettings.SplitIterations);
+	FParse::Value(cmdLine, TEXT("-splitdepth="), bspSettings.ParallelSplitDepth);
+
+	FRRPDungeonSettings rrpSettings{};
+	FParse::Value(cmdLine, TEXT("-rooms="), rrpSettings.NrOfRooms);
+	FParse::Value(cmdLine, TEXT("-window="), rrpSettings.SearchWindowMargin);
+	FParse::Value(cmdLine, TEXT("-clustersize="), rrpSettings.ClusterSize);
+	if (FParse::Param(cmdLine, TEXT("parallel")))
+		rrpSettings.SeperationMode = ERRPSeperationMode::PARALLEL;
+	if (FParse::Param(cmdLine, TEXT("parallelpaths")))
+		rrpSettings.PathfindingMode = ERRPPathfindingMode::PARALLEL;
+	if (FParse::Param(cmdLine, TEXT("mst")))
+		rrpSettings.CorridorType = ERRPCorridorType::MINIMUMSPANNINGTREE;
+	if (FParse::Param(cmdLine, TEXT("jps")))
+		rrpSettings.PathfindingAlgorithm = ERRPPathfindingAlgorithm::JUMPPOINTSEARCH;
+	if (FParse::Param(cmdLine, TEXT("hpa")))
+		rrpSettings.PathfindingAlgorithm = ERRPPathfindingAlgorithm::HIERARCHICAL;
+	const bool isComparingPaths = FParse::Param(cmdLine, TEXT("comparepaths"));
+	//-chunks generates BSP chunks of a streamed dungeon and checks that every chunk meets its neighbours
+	const bool isCheckingChunks = FParse::Param(cmdLine, TEXT("chunks"));
+	//-layout saves every BSP dungeon as a layout file and times loading it against generating
+	const bool isLoadingLayout = FParse::Param(cmdLine, TEXT("layout"));
+	const FString layoutFileName = FPaths::ProjectSavedDir() / TEXT("DungeonGeneration") / TEXT("BenchmarkLayout.dgl");
+	//-cache looks every dungeon up in an empty layout cache twice, the first lookup misses and generates, the second hits
+	const bool isUsingCache = FParse::Param(cmdLine, TEXT("cache"));
+	int cacheMemoryMB = 256;
+	FParse::Value(cmdLine, TEXT("-cachememorymb="), cacheMemoryMB);
+	FDungeonLayoutCache cache(FPaths::ProjectSavedDir() / TEXT("DungeonGeneration") / TEXT("BenchmarkLayoutCache"));
+	cache.SetLimits(int64(cacheMemoryMB) * 1024 * 1024, 1024ll * 1024 * 1024);
+	if (isUsingCache)
+		cache.Empty();
+	//-updateroom adds a premade room of 4 by 4 tiles in the middle of every RRP dungeon and times moving it against generating again
+	const bool isUpdatingRoom = FParse::Param(cmdLine, TEXT("updateroom"));
+	if (isUpdatingRoom && rrpSettings.PremadeRooms.Num() == 0)
+	{
+		FRRPRoom premadeRoom{};
+		premadeRoom.Width = rrpSettings.RoomTileSize * 4;
+		premadeRoom.Height = rrpSettings.RoomTileSize * 4;
+		premadeRoom.CentralPosition = rrpSettings.DungeonCentralPosition;
+		rrpSettings.PremadeRooms.Add(premadeRoom);
+	}
+
+	const bool isBSP = generatorName.Equals(TEXT("bsp"), ESearchCase::IgnoreCase);
+	const bool isRRP = generatorName.Equals(TEXT("rrp"), ESearchCase::IgnoreCase);
+	if (!isBSP && !isRRP)
+	{
+		UE_LOG(LogDungeonGenBenchmark, Error, TEXT("Unknown generator '%s', use -generator=bsp or -generator=rrp"), *generatorName);
+		FEngineLoop::AppExit();
+		return 1;
+	}
+
+	//Every dungeon gets the next seed, so a run is reproducible from the first seed
+	DungeonGenBenchmark::FTimings timings{};
+	DungeonGenBenchmark::FMemoryUsage generatorMemory{};
+	int64 totalNrOfMeshes = 0;
+	int nrOfMeshes = 0;
+	SIZE_T allocatedSize = 0;
+	FDungeonGenerationReport report{};
+	//Regenerating must not grow the process, the used memory after the first dungeon and after the last should match
+	SIZE_T usedMemoryAfterFirst = 0;
+	//-comparepaths generates every RRP dungeon with A*, Jump Point Search and the hierarchical search
+	const int nrOfPathAlgorithms = 3;
+	DungeonGenBenchmark::FTimings pathTimings[nrOfPathAlgorithms]{};
+	int64 nrOfNodesExpanded[nrOfPathAlgorithms]{};
+	int64 totalPathCosts[nrOfPathAlgorithms]{};
+	int nrOfDifferentPathCosts = 0;
+	DungeonGenBenchmark::FTimings updateTimings{};
+	int64 nrOfDirtyTileNodes = 0;
+	int nrOfFullGenerations = 0;
+	int nrOfOpenSeams = 0;
+	DungeonGenBenchmark::FTimings layoutTimings{};
+	DungeonGenBenchmark::FTimings cacheMissTimings{};
+	DungeonGenBenchmark::FTimings cacheHitTimings{};
+	int nrOfDifferentLayouts = 0;
+	for (int i = 0; i < count; i++)
+	{
+		if (isBSP)
+		{
+			bspSettings.Seed = seed + i;
+			timings.Add(DungeonGenBenchmark::RunBSP(bspSettings, nrOfMeshes, allocatedSize, report));
+			generatorMemory.Add(allocatedSize);
+			if (isCheckingChunks)
+			{
+				FBSPDungeonSettings worldSettings = bspSettings;
+				worldSettings.Seed = seed;
+				nrOfOpenSeams += DungeonGenBenchmark::RunChunkSeams(worldSettings, FIntPoint(i, -i));
+			}
+			if (isLoadingLayout)
+			{
+				bool isSameMeshes = false;
+				layoutTimings.Add(DungeonGenBenchmark::RunBSPLayout(bspSettings, layoutFileName, isSameMeshes));
+				nrOfDifferentLayouts += !isSameMeshes;
+			}
+		}
+		else
+		{
+			rrpSettings.Seed = seed + i;
+			timings.Add(DungeonGenBenchmark::RunRRP(rrpSettings, nrOfMeshes, report));
+			if (isComparingPaths)
+			{
+				//The heuristic is admissible, so A* and Jump Point Search both find the cheapest paths
+				FRRPDungeonSettings pathSettings = rrpSettings;
+				pathSettings.HeuresticCostFunction = ERRPHeuristicCost::ADMISSIBLEMANHATTAN;
+				for (int algorithm = 0; algorithm < nrOfPathAlgorithms; algorithm++)
+				{
+					pathSettings.PathfindingAlgorithm = static_cast<ERRPPathfindingAlgorithm>(algorithm);
+					FDungeonGenerationReport pathReport{};
+					int nrOfPathMeshes = 0;
+					DungeonGenBenchmark::RunRRP(pathSettings, nrOfPathMeshes, pathReport);
+					//Only the corridor phase is timed, the rooms and the grid are the same for every algorithm. The cluster graph is part of the hierarchical search
+					const double pathMilliseconds = pathReport.GetPhaseMilliseconds(TEXT("RandomRoomConnect")) + pathReport.GetPhaseMilliseconds(TEXT("MinimumSpanningTreeConnect"))
+						+ pathReport.GetPhaseMilliseconds(TEXT("BuildClusterGraph"));
+					pathTimings[algorithm].Add(pathMilliseconds / 1000.0);
+					nrOfNodesExpanded[algorithm] += pathReport.GetCounter(TEXT("NodesExpanded"));
+					totalPathCosts[algorithm] += pathReport.GetCounter(TEXT("PathCost"));
+				}
+				//Equally cheap paths can differ and change the later searches, so the totals of the dungeons are not compared.
+				//Every corridor is searched again on the same grid instead. The hierarchical paths are not the cheapest, they are not compared
+				pathSettings.PathfindingAlgorithm = ERRPPathfindingAlgorithm::ASTAR;
+				nrOfDifferentPathCosts += DungeonGenBenchmark::RunRRPPathComparison(pathSettings);
+			}
+			if (isUpdatingRoom)
+			{
+				FDungeonGenerationReport updateReport{};
+				updateTimings.Add(DungeonGenBenchmark::RunRRPUpdate(rrpSettings, updateReport));
+				nrOfDirtyTileNodes += updateReport.GetCounter(TEXT("DirtyTileNodes"));
+				nrOfFullGenerations += updateReport.GetCounter(TEXT("Updated")) == 0;
+			}
+		}
+		if (isUsingCache)
+		{
+			bool isHit = false;
+			const FSHAHash key = isBSP ? FDungeonLayoutCache::GetKey(bspSettings, FVector::OneVector) : FDungeonLayoutCache::GetKey(rrpSettings);
+			for (int lookup = 0; lookup < 2; lookup++)
+			{
+				const double seconds = isBSP ? DungeonGenBenchmark::RunCached<FBSPDungeonGenerator>(bspSettings, key, cache, isHit)
+					: DungeonGenBenchmark::RunCached<FRRPDungeonGenerator>(rrpSettings, key, cache, isHit);
+				(isHit ? cacheHitTimings : cacheMissTimings).Add(seconds);
+			}
+		}
+		totalNrOfMeshes += nrOfMeshes;
+		if (i == 0)
+			usedMemoryAfterFirst = FPlatformMemory::GetStats().UsedPhysical;
+
+		//One CSV row per dungeon, the phase timings show which step regressed
+		if (!reportPath.IsEmpty())
+			report.AppendToCsvFile(reportPath);
+	}
+
+	UE_LOG(LogDungeonGenBenchmark, Display, TEXT("%s: %d dungeons from seed %d"), *generatorName.ToUpper(), count, seed);
+	UE_LOG(LogDungeonGenBenchmark, Display, TEXT("min %.3f ms, avg %.3f ms, max %.3f ms, total %.3f s"),
+		timings.Min * 1000.0, timings.Total / timings.Count * 1000.0, timings.Max * 1000.0, timings.Total);
+	UE_LOG(LogDungeonGenBenchmark, Display, TEXT("avg %lld meshes per dungeon"), totalNrOfMeshes / count);
+	const SIZE_T usedMemoryAfterLast = FPlatformMemory::GetStats().UsedPhysical;
+	UE_LOG(LogDungeonGenBenchmark, Display, TEXT("used memory after first dungeon %llu KB, after last %llu KB (%+lld KB)"),
+		(uint64)usedMemoryAfterFirst / 1024, (uint64)usedMemoryAfterLast / 1024, ((int64)usedMemoryAfterLast - (int64)usedMemoryAfterFirst) / 1024);
+	if (isBSP)
+		UE_LOG(LogDungeonGenBenchmark, Display, TEXT("generator allocated min %llu KB, max %llu KB"), (uint64)generatorMemory.Min / 1024, (uint64)generatorMemory.Max / 1024);
+	if (isBSP && isCheckingChunks)
+		UE_LOG(LogDungeonGenBenchmark, Display, TEXT("%d of %d chunk seams are open on both sides"), nrOfOpenSeams, count * 2);
+	if (isBSP && isLoadingLayout)
+	{
+		UE_LOG(LogDungeonGenBenchmark, Display, TEXT("load layout: min %.3f ms, avg %.3f ms, max %.3f ms, %d of %d layouts gave other meshes"),
+			layoutTimings.Min * 1000.0, layoutTimings.Total / layoutTimings.Count * 1000.0, layoutTimings.Max * 1000.0, nrOfDifferentLayouts, count);
+	}
+	if (isUsingCache)
+	{
+		const FDungeonLayoutCacheStats stats = cache.GetStats();
+		UE_LOG(LogDungeonGenBenchmark, Display, TEXT("layout cache: miss avg %.3f ms, hit avg %.3f ms"),
+			cacheMissTimings.Count > 0 ? cacheMissTimings.Total / cacheMissTimings.Count * 1000.0 : 0.0, cacheHitTimings.Count > 0 ? cacheHitTimings.Total / cacheHitTimings.Count * 1000.0 : 0.0);
+		UE_LOG(LogDungeonGenBenchmark, Display, TEXT("layout cache: %lld memory hits, %lld disk hits, %lld misses, %lld evictions, %lld KB in memory, %lld KB on disk"),
+			stats.MemoryHits, stats.DiskHits, stats.Misses, stats.MemoryEvictions + stats.DiskEvictions, stats.MemoryBytes / 1024, stats.DiskBytes / 1024);
+	}
+	if (isRRP && isComparingPaths)
+	{
+		const TCHAR* algorithmNames[nrOfPathAlgorithms] = { TEXT("A*"), TEXT("JPS"), TEXT("HPA*") };
+		for (int algorithm = 0; algorithm < nrOfPathAlgorithms; algorithm++)
+		{
+			UE_LOG(LogDungeonGenBenchmark, Display, TEXT("%s: corridors avg %.3f ms, avg %lld nodes expanded, avg path cost %lld"),
+				algorithmNames[algorithm], pathTimings[algorithm].Total / pathTimings[algorithm].Count * 1000.0, nrOfNodesExpanded[algorithm] / count, totalPathCosts[algorithm] / count);
+		}
+		if (nrOfDifferentPathCosts > 0)
+			UE_LOG(LogDungeonGenBenchmark, Error, TEXT("%d corridors have a different path cost with A* and JPS"), nrOfDifferentPathCosts);
+	}
+	if (isRRP && isUpdatingRoom)
+	{
+		UE_LOG(LogDungeonGenBenchmark, Display, TEXT("move premade room: min %.3f ms, avg %.3f ms, max %.3f ms, avg %lld dirty TileNodes, %d did not fit"),
+			updateTimings.Min * 1000.0, updateTimings.Total / updateTimings.Count * 1000.0, updateTimings.Max * 1000.0, nrOfDirtyTileNodes / count, nrOfFullGenerations);
+	}
+
+	FEngineLoop::AppExit();
+	//A* and Jump Point Search finding paths with a different cost fails the benchmark
+	return nrOfDifferentPathCosts > 0 ? 1 : 0;
+}
@@ -0,0 +1,14 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+using UnrealBuildTool;
+
+public class DungeonGenerationCore : ModuleRules
+{
+	public DungeonGenerationCore(ReadOnlyTargetRules Target) : base(Target)
+	{
+		PCHUsage = PCHUsageMode.UseExplicitOrSharedPCHs;
+
+		// Only Core, so the generators can run without the engine (see the DungeonGenBenchmark program)
+		PublicDependencyModuleNames.AddRange(new string[] { "Core" });
+	}
+}
@@ -0,0 +1,665 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "BSPDungeonGenerator.h"
+#include "DungeonGenerationCore.h"
+#include "Async/ParallelFor.h"
+
+DECLARE_CYCLE_STAT(TEXT("BSP GenerateDungeon"), STAT_BSPGenerateDungeon, STATGROUP_DungeonGeneration);
+DECLARE_CYCLE_STAT(TEXT("BSP SplitSpace"), STAT_BSPSplitSpace, STATGROUP_DungeonGeneration);
+DECLARE_CYCLE_STAT(TEXT("BSP SelectDungeonRooms"), STAT_BSPSelectDungeonRooms, STATGROUP_DungeonGeneration);
+DECLARE_CYCLE_STAT(TEXT("BSP FillTileGrid"), STAT_BSPFillTileGrid, STATGROUP_DungeonGeneration);
+DECLARE_CYCLE_STAT(TEXT("BSP PlaceWalls"), STAT_BSPPlaceWalls, STATGROUP_DungeonGeneration);
+DECLARE_CYCLE_STAT(TEXT("BSP GetMeshInstances"), STAT_BSPGetMeshInstances, STATGROUP_DungeonGeneration);
+DECLARE_DWORD_COUNTER_STAT(TEXT("BSP Spaces"), STAT_BSPSpaces, STATGROUP_DungeonGeneration);
+DECLARE_DWORD_COUNTER_STAT(TEXT("BSP Rooms"), STAT_BSPRooms, STATGROUP_DungeonGeneration);
+DECLARE_MEMORY_STAT(TEXT("BSP Allocated"), STAT_BSPAllocatedSize, STATGROUP_DungeonGeneration);
+
+FBSPDungeonGenerator::FBSPDungeonGenerator(const FBSPDungeonSettings& settings)
+	:Settings(settings)
+	, RandomStream(settings.Seed)
+{
+	TileRows = Settings.DungeonSize / Settings.TileSize;
+	TileArray.Init(FTile(), TileRows * TileRows);
+}
+
+bool FBSPDungeonGenerator::GenerateDungeon()
+{
+	SCOPE_CYCLE_COUNTER(STAT_BSPGenerateDungeon);
+	Report.Reset(TEXT("BSP"), Settings.Seed);
+	NrOfSpaces = 0;
+	FDungeonRandomStream rootStream = RandomStream.Split(RootStreamID);
+
+	//generate BSP Dungeon
+	const int maxElements = pow(2, Settings.SplitIterations + 1) - 1;
+	Spaces.Init(FSpace(), maxElements);
+	DungeonCorridors.Init(FCorridor(), maxElements);
+	DungeonRooms.Reset();
+	FData parentData = FData();
+	parentData.width = Settings.DungeonSize;
+	parentData.height = Settings.DungeonSize;
+	parentData.left = 0;
+	parentData.bottom = 0;
+	parentData.seperation = ESeperation(rootStream.RandRange(0, 1));
+	parentData.tilesSeperated = rootStream.RandRange(Settings.MinTilesPerRoom, Settings.DungeonSize / Settings.TileSize - Settings.MinTilesPerRoom);
+	{
+		SCOPE_CYCLE_COUNTER(STAT_BSPSplitSpace);
+		FDungeonGenerationPhaseScope phaseScope(Report, TEXT("SplitSpace"));
+		if (CanSpaceBeUsed(parentData))
+			SplitSpace(0, maxElements, parentData, 0);
+	}
+	if (IsCancelled())
+		return false;
+	{
+		SCOPE_CYCLE_COUNTER(STAT_BSPSelectDungeonRooms);
+		FDungeonGenerationPhaseScope phaseScope(Report, TEXT("SelectDungeonRooms"));
+		SelectDungeonRooms(0, 0);
+	}
+	for (auto& space : Spaces)
+	{
+		NrOfSpaces += space.isUsed;
+	}
+	if (IsCancelled())
+		return false;
+	{
+		SCOPE_CYCLE_COUNTER(STAT_BSPFillTileGrid);
+		FDungeonGenerationPhaseScope phaseScope(Report, TEXT("FillTileGrid"));
+		FillTileGrid();
+	}
+	if (IsCancelled())
+		return false;
+	{
+		SCOPE_CYCLE_COUNTER(STAT_BSPPlaceWalls);
+		FDungeonGenerationPhaseScope phaseScope(Report, TEXT("PlaceWalls"));
+		PlaceWalls();
+		OpenDoorTiles();
+	}
+
+	int nrOfCorridors = 0;
+	for (auto& corridor : DungeonCorridors)
+	{
+		nrOfCorridors += corridor.isUsed;
+	}
+	int nrOfRoomTiles = 0;
+	int nrOfCorridorTiles = 0;
+	int nrOfDungeonObjects = 0;
+	for (auto& tile : TileArray)
+	{
+		nrOfRoomTiles += tile.tileType == ETileType::ROOM;
+		nrOfCorridorTiles += tile.tileType == ETileType::CORRIDOR;
+		nrOfDungeonObjects += (tile.tileType != ETileType::EMPTY) + FMath::CountBits(tile.wallMask);
+	}
+	Report.SetCounter(TEXT("Spaces"), NrOfSpaces);
+	Report.SetCounter(TEXT("Rooms"), DungeonRooms.Num());
+	Report.SetCounter(TEXT("Corridors"), nrOfCorridors);
+	Report.SetCounter(TEXT("RoomTiles"), nrOfRoomTiles);
+	Report.SetCounter(TEXT("CorridorTiles"), nrOfCorridorTiles);
+	Report.SetCounter(TEXT("DungeonObjects"), nrOfDungeonObjects);
+	Report.SetCounter(TEXT("AllocatedBytes"), GetAllocatedSize());
+
+	SET_DWORD_STAT(STAT_BSPSpaces, NrOfSpaces);
+	SET_DWORD_STAT(STAT_BSPRooms, DungeonRooms.Num());
+	SET_MEMORY_STAT(STAT_BSPAllocatedSize, GetAllocatedSize());
+	return true;
+}
+
+void FBSPDungeonGenerator::GetMeshInstances(const FTransform& baseTransform, FDungeonMeshInstances& outMeshes) const
+{
+	if (TileArray.Num() == 0)
+		return;
+
+	//the tile type and wall mask are read with the stride of FTile
+	FDungeonTilePlanes planes{};
+	planes.TileTypes = reinterpret_cast<const uint8*>(&TileArray.GetData()->tileType);
+	planes.WallMasks = &TileArray.GetData()->wallMask;
+	planes.Stride = sizeof(FTile);
+	planes.TileRows = TileRows;
+	GetMeshInstances(planes, Settings.TileSize, Settings.WallTileWidth, baseTransform, outMeshes);
+}
+
+void FBSPDungeonGenerator::GetMeshInstances(const FDungeonTilePlanes& planes, int tileSize, int wallTileWidth, const FTransform& baseTransform, FDungeonMeshInstances& outMeshes)
+{
+	SCOPE_CYCLE_COUNTER(STAT_BSPGetMeshInstances);
+
+	//every tile that is not empty has 1 floor, the walls are the set bits of the wall mask
+	const int nrOfTiles = planes.TileRows * planes.TileRows;
+	int nrOfFloors = 0;
+	int nrOfWalls = 0;
+	for (int tileIndex = 0; tileIndex < nrOfTiles; tileIndex++)
+	{
+		nrOfFloors += planes.GetTileType(tileIndex) != ETileType::EMPTY;
+		nrOfWalls += FMath::CountBits(planes.GetWallMask(tileIndex));
+	}
+	outMeshes.FloorTransforms.Reserve(outMeshes.FloorTransforms.Num() + nrOfFloors);
+	outMeshes.FloorCustomData.Reserve(outMeshes.FloorCustomData.Num() + nrOfFloors);
+	outMeshes.WallTransforms.Reserve(outMeshes.WallTransforms.Num() + nrOfWalls);
+	outMeshes.WallCustomData.Reserve(outMeshes.WallCustomData.Num() + nrOfWalls);
+
+	FTransform dungeonTileTranform = baseTransform;
+	TArray<FTransform>* transformsToAddInstance = nullptr;
+	TArray<float>* customDataToAddInstance = nullptr;
+	int objectWidth;
+	TArray<FDungeonObject, TInlineAllocator<5>> objectsToSpawn{};
+
+	//the tiles are stored row by row, so one scan over the array visits them in the same order as the rows and columns
+	for (int tileIndex = 0; tileIndex < nrOfTiles; tileIndex++)
+	{
+		//Check if tile is not empty
+		const ETileType tileType = planes.GetTileType(tileIndex);
+		if (tileType == ETileType::EMPTY)
+			continue;
+
+		//create instances for all objectsToSpawn on the tile
+		GetObjectsToSpawn(tileType, planes.GetWallMask(tileIndex), objectsToSpawn);
+		const int left = (tileIndex % planes.TileRows) * tileSize;
+		const int bottom = (tileIndex / planes.TileRows) * tileSize;
+		for (const FDungeonObject& objectToSpawn : objectsToSpawn)
+		{
+			//change instance array depending on object type and the object width (helps with alighning object)
+			switch (objectToSpawn.objectType)
+			{
+			case EDungeonObjectType::FLOOR:
+				transformsToAddInstance = &outMeshes.FloorTransforms;
+				customDataToAddInstance = &outMeshes.FloorCustomData;
+				objectWidth = 0;
+				break;
+			case EDungeonObjectType::WALL:
+				transformsToAddInstance = &outMeshes.WallTransforms;
+				customDataToAddInstance = &outMeshes.WallCustomData;
+				objectWidth = wallTileWidth;
+			case EDungeonObjectType::CEILING:
+				break;
+			case EDungeonObjectType::PILLAR:
+				break;
+			case EDungeonObjectType::TORCH:
+				break;
+			}
+
+			//change transform to alignment of object
+			FVector rotationVector = objectToSpawn.rotation;
+			float customDataValue = 0.7f;
+			switch (objectToSpawn.objectAlignement)
+			{
+			case EDungeonObjectAlign::LEFT:
+				dungeonTileTranform.SetLocation(FVector(left + tileSize, bottom + tileSize / 2, 0));
+				dungeonTileTranform.SetRotation(rotationVector.Rotation().Quaternion());
+				customDataValue = 0.2f;
+				break;
+			case EDungeonObjectAlign::RIGHT:
+				dungeonTileTranform.SetLocation(FVector(left, bottom + tileSize / 2, 0));
+				dungeonTileTranform.SetRotation(rotationVector.Rotation().Quaternion());
+				customDataValue = 0.2f;
+				break;
+			case EDungeonObjectAlign::TOP:
+				dungeonTileTranform.SetLocation(FVector(left + tileSize / 2, bottom + tileSize, 0));
+				dungeonTileTranform.SetRotation(rotationVector.Rotation().Quaternion());
+				customDataValue = 0.7f;
+				break;
+			case EDungeonObjectAlign::BOTTOM:
+				dungeonTileTranform.SetLocation(FVector(left + tileSize / 2, bottom, 0));
+				dungeonTileTranform.SetRotation(rotationVector.Rotation().Quaternion());
+				customDataValue = 0.7f;
+				break;
+			case EDungeonObjectAlign::CENTER:
+				dungeonTileTranform.SetLocation(FVector(left + tileSize / 2, bottom + tileSize / 2, 0));
+				dungeonTileTranform.SetRotation(rotationVector.Rotation().Quaternion());
+				break;
+			}
+
+			if (transformsToAddInstance != nullptr)
+			{
+				transformsToAddInstance->Add(dungeonTileTranform);
+				customDataToAddInstance->Add(customDataValue);
+			}
+
+			transformsToAddInstance = nullptr;
+			customDataToAddInstance = nullptr;
+		}
+	}
+}
+
+void FBSPDungeonGenerator::GetObjectsToSpawn(int tileIndex, TArray<FDungeonObject, TInlineAllocator<5>>& outObjects) const
+{
+	GetObjectsToSpawn(TileArray[tileIndex].tileType, TileArray[tileIndex].wallMask, outObjects);
+}
+
+void FBSPDungeonGenerator::GetObjectsToSpawn(ETileType tileType, uint8 wallMask, TArray<FDungeonObject, TInlineAllocator<5>>& outObjects)
+{
+	outObjects.Reset();
+	if (tileType == ETileType::EMPTY)
+		return;
+
+	outObjects.Add(FDungeonObject()); //default object is a floor
+	if (wallMask & (1 << uint8(EDungeonObjectAlign::LEFT)))
+		outObjects.Add(FDungeonObject(EDungeonObjectType::WALL, EDungeonObjectAlign::LEFT, FVector(1, 0, 0)));
+	if (wallMask & (1 << uint8(EDungeonObjectAlign::RIGHT)))
+		outObjects.Add(FDungeonObject(EDungeonObjectType::WALL, EDungeonObjectAlign::RIGHT, FVector(1, 0, 0)));
+	if (wallMask & (1 << uint8(EDungeonObjectAlign::TOP)))
+		outObjects.Add(FDungeonObject(EDungeonObjectType::WALL, EDungeonObjectAlign::TOP, FVector(0, -1, 0)));
+	if (wallMask & (1 << uint8(EDungeonObjectAlign::BOTTOM)))
+		outObjects.Add(FDungeonObject(EDungeonObjectType::WALL, EDungeonObjectAlign::BOTTOM, FVector(0, -1, 0)));
+}
+
+void FBSPDungeonGenerator::GetRoomTileRects(TArray<FIntRect>& outRooms) const
+{
+	outRooms.Reset(DungeonRooms.Num());
+	for (int roomKey : DungeonRooms)
+	{
+		const FData& roomData = Spaces[roomKey].data;
+		outRooms.Add(FIntRect(roomData.left / Settings.TileSize, roomData.bottom / Settings.TileSize,
+			(roomData.left + roomData.width) / Settings.TileSize, (roomData.bottom + roomData.height) / Settings.TileSize));
+	}
+}
+
+void FBSPDungeonGenerator::PrintTree(FString& string) const
+{
+	PrintTree(string, 0);
+}
+
+SIZE_T FBSPDungeonGenerator::GetAllocatedSize() const
+{
+	return Spaces.GetAllocatedSize() + DungeonRooms.GetAllocatedSize() + DungeonCorridors.GetAllocatedSize() + TileArray.GetAllocatedSize() + Occupancy.GetAllocatedSize();
+}
+
+void FBSPDungeonGenerator::SplitSpace(int index, int maxElements, FData spaceData, int currentDepth)
+{
+	if (index >= maxElements)
+		return;
+
+	FSpace& currentSpace = Spaces[index];
+	currentSpace.isUsed = true;
+	currentSpace.data.key = index;
+	currentSpace.data.width = spaceData.width;
+	currentSpace.data.height = spaceData.height;
+	currentSpace.data.left = spaceData.left;
+	currentSpace.data.bottom = spaceData.bottom;
+
+	//a space that is too small is not split, both children are made or neither so the space stays a single leaf
+	if (!CanSpaceBeUsed(spaceData))
+		return;
+
+	//calculate next split, every space has its own random stream so the tree does not depend on the order it is built in
+	FDungeonRandomStream splitStream = RandomStream.Split(SplitStreamID).Split(index);
+	int minXTiles = int((float(spaceData.height) * Settings.MinRoomRatio)) / Settings.TileSize;
+	int maxXTiles = (spaceData.width / Settings.TileSize) - minXTiles;
+	bool isVerticalSplitValid = minXTiles < maxXTiles;
+
+	int minYTiles = int((float(spaceData.width) * Settings.MinRoomRatio)) / Settings.TileSize;
+	int maxYTiles = (spaceData.height / Settings.TileSize) - minYTiles;
+	bool isHorizontalSplitValid = minYTiles < maxYTiles;
+
+	if (isVerticalSplitValid && isHorizontalSplitValid)
+	{
+		//randomize split
+		spaceData.seperation = ESeperation(splitStream.RandRange(0, 1));
+		if (spaceData.seperation == ESeperation::VERTICAL)
+			spaceData.tilesSeperated = splitStream.RandRange(minXTiles, maxXTiles);
+		else
+			spaceData.tilesSeperated = splitStream.RandRange(maxYTiles, maxYTiles);
+	}
+	else if (isVerticalSplitValid && !isHorizontalSplitValid)
+	{
+		//vertical split
+		spaceData.tilesSeperated = splitStream.RandRange(minXTiles, maxXTiles);
+		spaceData.seperation = ESeperation::VERTICAL;
+	}
+	else if (!isVerticalSplitValid && isHorizontalSplitValid)
+	{
+		//horizontal split
+		spaceData.tilesSeperated = splitStream.RandRange(minYTiles, maxYTiles);
+		spaceData.seperation = ESeperation::HORIZONTAL;
+	}
+	else // no split possible
+		return;
+
+	const int leftIndex = 2 * index + 1;
+	const int rightIndex = 2 * index + 2;
+	const FData leftData = GetChildSpaceData(spaceData, true);
+	const FData rightData = GetChildSpaceData(spaceData, false);
+
+	//the corridor between the two children is made here, so the children never write to the same corridor
+	if (rightIndex < maxElements)
+	{
+		//startpoint near the center of the left or top space, endpoint near the center of the right or bottom space
+		const FIntPoint start{ leftData.left / Settings.TileSize + leftData.width / Settings.TileSize / 2 - 1, leftData.bottom / Settings.TileSize + leftData.height / Settings.TileSize / 2 + 1 };
+		const FIntPoint end{ rightData.left / Settings.TileSize + rightData.width / Settings.TileSize / 2 + 1, rightData.bottom / Settings.TileSize + rightData.height / Settings.TileSize / 2 - 1 };
+
+		FCorridor& corridor = DungeonCorridors[leftIndex];
+		corridor.seperation = spaceData.seperation;
+		corridor.isUsed = true;
+		corridor.AddPoint(start);
+		if (spaceData.seperation == ESeperation::VERTICAL) //vertical seperation = horizontal corridor
+			corridor.AddPoint(FIntPoint(end.X, start.Y));
+		else //horizontal seperation = vertical corridor
+			corridor.AddPoint(FIntPoint(start.X, end.Y));
+	}
+
+	//both subtrees only write to their own spaces and corridors, so the top of the tree is split on worker threads
+	if (currentDepth < Settings.ParallelSplitDepth)
+	{
+		ParallelFor(2, [this, leftIndex, maxElements, &leftData, &rightData, currentDepth](int child)
+		{
+			SplitSpace(leftIndex + child, maxElements, child == 0 ? leftData : rightData, currentDepth + 1);
+		});
+	}
+	else
+	{
+		SplitSpace(leftIndex, maxElements, leftData, currentDepth + 1);
+
+		SplitSpace(rightIndex, maxElements, rightData, currentDepth + 1);
+	}
+}
+
+FData FBSPDungeonGenerator::GetChildSpaceData(const FData& parentData, bool isLeftChild) const
+{
+	FData childData = parentData;
+	if (isLeftChild)//left or top of the space split
+	{
+		if (parentData.seperation == ESeperation::VERTICAL)
+		{
+			childData.width = Settings.TileSize * parentData.tilesSeperated;
+		}
+		else
+		{
+			childData.height = parentData.height - (Settings.TileSize * parentData.tilesSeperated);
+			childData.bottom = parentData.bottom + Settings.TileSize * parentData.tilesSeperated;
+		}
+	}
+	else//right or bottom of the space split
+	{
+		if (parentData.seperation == ESeperation::VERTICAL)
+		{
+			childData.width = parentData.width - (Settings.TileSize * parentData.tilesSeperated);
+			childData.left = parentData.left + Settings.TileSize * parentData.tilesSeperated;
+		}
+		else
+		{
+			childData.height = Settings.TileSize * parentData.tilesSeperated;
+		}
+	}
+	return childData;
+}
+
+bool FBSPDungeonGenerator::CanSpaceBeUsed(const FData& spaceData) const
+{
+	//check if the width and height are still big enough to split
+	const int minRoomSize = Settings.TileSize * Settings.MinTilesPerRoom + Settings.TileSize * 2;
+	return spaceData.width > minRoomSize || spaceData.height > minRoomSize;
+}
+
+void FBSPDungeonGenerator::PrintTree(FString& string, int index) const
+{
+	if (IsSpaceUsed(index))
+	{
+		PrintTree(string, 2 * index + 1);
+		string.Append(FString::FromInt(Spaces[index].data.key));
+		string.Append(TEXT(" "));
+		PrintTree(string, 2 * index + 2);
+	}
+}
+
+void FBSPDungeonGenerator::SelectDungeonRooms(int index, int currentDepth)
+{
+	if (!IsSpaceUsed(index))
+		return;
+
+	if (currentDepth == Settings.SplitIterations || (!IsSpaceUsed(2 * index + 1) || !IsSpaceUsed(2 * index + 2)))
+	{
+		DungeonRooms.Add(index);
+	}
+
+	SelectDungeonRooms(2 * index + 1, currentDepth + 1);
+	SelectDungeonRooms(2 * index + 2, currentDepth + 1);
+}
+
+void FBSPDungeonGenerator::FillTileGrid()
+{
+	//the occupancy bitmap is filled together with the tiles, PlaceWalls uses it to find the walls
+	OccupancyWordsPerRow = (TileRows + 63) / 64;
+	Occupancy.Reset();
+	Occupancy.SetNumZeroed(OccupancyWordsPerRow * TileRows);
+
+	//Fill rooms in grid with floor tiles, 1 span per row of the room
+	for (int i = 0; i < DungeonRooms.Num(); i++)
+	{
+		FSpace& room = Spaces[DungeonRooms[i]];
+		ShrinkSpaceToRoom(room); //todo fix corridor connections
+
+		const int firstCol = room.data.left / Settings.TileSize;
+		const int lastCol = (room.data.left + room.data.width) / Settings.TileSize - 1;
+		const int firstRow = room.data.bottom / Settings.TileSize;
+		const int lastRow = (room.data.bottom + room.data.height) / Settings.TileSize - 1;
+		for (int row = firstRow; row <= lastRow; row++)
+		{
+			FillTileSpan(row, firstCol, lastCol, ETileType::ROOM, -1);
+		}
+	}
+
+	//fill corridors in grid with floor tiles, a corridor only takes the tiles that are still empty
+	for (int corridorID = 0; corridorID < DungeonCorridors.Num(); corridorID++)
+	{
+		const FCorridor& corridor = DungeonCorridors[corridorID];
+		if (!corridor.isUsed)
+			continue;
+
+		for (int i = 0; i + 1 < corridor.nrOfPoints; i++)
+		{
+			FillCorridorSegment(corridor.points[i], corridor.points[i + 1], corridorID);
+		}
+	}
+
+	FillDoorCorridors();
+}
+
+void FBSPDungeonGenerator::FillDoorCorridors()
+{
+	if (DungeonRooms.Num() == 0)
+		return;
+
+	for (int doorIndex = 0; doorIndex < Settings.DoorTiles.Num(); doorIndex++)
+	{
+		const FIntPoint& door = Settings.DoorTiles[doorIndex];
+		if (door.X < 0 || door.X >= TileRows || door.Y < 0 || door.Y >= TileRows)
+			continue;
+
+		//the center tile of the closest room, the rooms are already shrunk
+		FIntPoint closestRoomCenter{};
+		int closestDistance = MAX_int32;
+		for (int roomKey : DungeonRooms)
+		{
+			const FData& roomData = Spaces[roomKey].data;
+			const FIntPoint roomCenter((roomData.left + roomData.width / 2) / Settings.TileSize, (roomData.bottom + roomData.height / 2) / Settings.TileSize);
+			const int distance = FMath::Abs(roomCenter.X - door.X) + FMath::Abs(roomCenter.Y - door.Y);
+			if (distance < closestDistance)
+			{
+				closestDistance = distance;
+				closestRoomCenter = roomCenter;
+			}
+		}
+
+		//the corridors of the doors come after the corridors of the spaces,
+		//a door on the left or right border starts along its row, a door on the bottom or top border ends along its column
+		const int corridorID = DungeonCorridors.Num() + doorIndex;
+		if (door.X == 0 || door.X == TileRows - 1)
+			FillCorridorSegment(door, closestRoomCenter, corridorID);
+		else
+			FillCorridorSegment(closestRoomCenter, door, corridorID);
+	}
+}
+
+void FBSPDungeonGenerator::FillCorridorSegment(const FIntPoint& from, const FIntPoint& to, int corridorID)
+{
+	//along the row as 1 span, an L starts with this part
+	FillTileSpan(from.Y, FMath::Min(from.X, to.X), FMath::Max(from.X, to.X), ETileType::CORRIDOR, corridorID);
+
+	//along the column, 1 tile per row
+	for (int row = FMath::Min(from.Y, to.Y); row <= FMath::Max(from.Y, to.Y); row++)
+	{
+		if (row != from.Y)
+			FillTileSpan(row, to.X, to.X, ETileType::CORRIDOR, corridorID);
+	}
+}
+
+void FBSPDungeonGenerator::FillTileSpan(int row, int firstCol, int lastCol, ETileType tileType, int corridorID)
+{
+	//clip the span to the grid
+	if (row < 0 || row >= TileRows)
+		return;
+	firstCol = FMath::Max(firstCol, 0);
+	lastCol = FMath::Min(lastCol, TileRows - 1);
+	if (firstCol > lastCol)
+		return;
+
+	//contiguous writes over the tiles of the span
+	FTile* tile = &TileArray[row * TileRows + firstCol];
+	FTile* const lastTile = &TileArray[row * TileRows + lastCol];
+	for (; tile <= lastTile; ++tile)
+	{
+		if (tileType == ETileType::ROOM || tile->tileType == ETileType::EMPTY)
+		{
+			tile->tileType = tileType;
+			tile->corridorID = corridorID;
+		}
+	}
+
+	//set the bits of the span in the occupancy bitmap, whole words at a time
+	uint64* occupancyRow = &Occupancy[row * OccupancyWordsPerRow];
+	for (int word = firstCol / 64; word <= lastCol / 64; word++)
+	{
+		const int firstBit = FMath::Max(firstCol - word * 64, 0);
+		const int lastBit = FMath::Min(lastCol - word * 64, 63);
+		const uint64 bitsUpToLast = lastBit == 63 ? ~uint64(0) : (uint64(1) << (lastBit + 1)) - 1;
+		occupancyRow[word] |= bitsUpToLast & ~((uint64(1) << firstBit) - 1);
+	}
+}
+
+void FBSPDungeonGenerator::ShrinkSpaceToRoom(FSpace& currentSpace)
+{
+	FDungeonRandomStream roomStream = RandomStream.Split(RoomStreamID).Split(currentSpace.data.key);
+
+	//check if there are spare tiles
+	int extraTilesInWidth = (currentSpace.data.width / Settings.TileSize) - Settings.MinTilesPerRoom;
+	extraTilesInWidth = FMath::Min(extraTilesInWidth, (currentSpace.data.width / Settings.TileSize / 2));
+	if (extraTilesInWidth > 1)
+	{
+		extraTilesInWidth = roomStream.RandRange(1, extraTilesInWidth);
+		currentSpace.data.width -= extraTilesInWidth * Settings.TileSize;
+		if (extraTilesInWidth % 2 == 1)
+			extraTilesInWidth = -1;
+		currentSpace.data.left += (extraTilesInWidth / 2) * Settings.TileSize;
+	}
+
+
+	int extraTilesInHeight = (currentSpace.data.height / Settings.TileSize) - Settings.MinTilesPerRoom;
+	extraTilesInHeight = FMath::Min(extraTilesInHeight, (currentSpace.data.height / Settings.TileSize) / 2);
+	if (extraTilesInHeight > 1)
+	{
+		extraTilesInHeight = roomStream.RandRange(1, extraTilesInHeight);
+		currentSpace.data.height -= extraTilesInHeight * Settings.TileSize;
+		if (extraTilesInHeight % 2 == 1)
+			extraTilesInHeight = -1;
+		currentSpace.data.bottom += (extraTilesInHeight / 2) * Settings.TileSize;
+	}
+}
+
+bool FBSPDungeonGenerator::IsCorridorConnected(int tileIndex) const
+{
+	//check for 2 connections
+	int connections = 0;
+
+	//adjacent tile LEFT
+	int adjacentTileIndex = tileIndex - 1;
+	if (TileArray.IsValidIndex(adjacentTileIndex) && TileArray[adjacentTileIndex].tileType != ETileType::EMPTY)
+	{
+		connections++;
+	}
+
+	//adjacent tile RIGHT
+	adjacentTileIndex = tileIndex + 1;
+	if (TileArray.IsValidIndex(adjacentTileIndex) && TileArray[adjacentTileIndex].tileType != ETileType::EMPTY)
+	{
+		connections++;
+	}
+
+	//adjacent tile TOP
+	adjacentTileIndex = tileIndex + TileRows;
+	if (TileArray.IsValidIndex(adjacentTileIndex) && TileArray[adjacentTileIndex].tileType != ETileType::EMPTY)
+	{
+		connections++;
+	}
+
+	//adjacent tile BOT
+	adjacentTileIndex = tileIndex - TileRows;
+	if (TileArray.IsValidIndex(adjacentTileIndex) && TileArray[adjacentTileIndex].tileType != ETileType::EMPTY)
+	{
+		connections++;
+	}
+
+	return connections > 1;
+}
+
+void FBSPDungeonGenerator::PlaceWalls()
+{
+	//a tile gets a wall on every side where the adjacent tile is empty or outside the grid,
+	//the bits past the last column and the rows outside the grid are 0 so the edges of the grid always get a wall
+	for (int row = 0; row < TileRows; row++)
+	{
+		const uint64* currentRow = &Occupancy[row * OccupancyWordsPerRow];
+		const uint64* rowAbove = row + 1 < TileRows ? &Occupancy[(row + 1) * OccupancyWordsPerRow] : nullptr;
+		const uint64* rowBelow = row > 0 ? &Occupancy[(row - 1) * OccupancyWordsPerRow] : nullptr;
+		for (int word = 0; word < OccupancyWordsPerRow; word++)
+		{
+			const uint64 occupied = currentRow[word];
+			if (occupied == 0)
+				continue;
+
+			//shift the row by 1 column, carrying the bit over from the adjacent word
+			const uint64 nextWord = word + 1 < OccupancyWordsPerRow ? currentRow[word + 1] : 0;
+			const uint64 previousWord = word > 0 ? currentRow[word - 1] : 0;
+			const uint64 isNextColOccupied = (occupied >> 1) | (nextWord << 63);
+			const uint64 isPreviousColOccupied = (occupied << 1) | (previousWord >> 63);
+			const uint64 isRowAboveOccupied = rowAbove != nullptr ? rowAbove[word] : 0;
+			const uint64 isRowBelowOccupied = rowBelow != nullptr ? rowBelow[word] : 0;
+
+			const uint64 leftWalls = occupied & ~isNextColOccupied;
+			const uint64 rightWalls = occupied & ~isPreviousColOccupied;
+			const uint64 topWalls = occupied & ~isRowAboveOccupied;
+			const uint64 bottomWalls = occupied & ~isRowBelowOccupied;
+
+			//write the wall mask of every occupied tile in the word
+			uint64 remaining = occupied;
+			while (remaining != 0)
+			{
+				const uint64 bit = FMath::CountTrailingZeros64(remaining);
+				remaining &= remaining - 1;
+
+				uint8 wallMask = 0;
+				wallMask |= ((leftWalls >> bit) & 1) << uint8(EDungeonObjectAlign::LEFT);
+				wallMask |= ((rightWalls >> bit) & 1) << uint8(EDungeonObjectAlign::RIGHT);
+				wallMask |= ((topWalls >> bit) & 1) << uint8(EDungeonObjectAlign::TOP);
+				wallMask |= ((bottomWalls >> bit) & 1) << uint8(EDungeonObjectAlign::BOTTOM);
+				TileArray[row * TileRows + word * 64 + int(bit)].wallMask = wallMask;
+			}
+		}
+	}
+}
+
+void FBSPDungeonGenerator::OpenDoorTiles()
+{
+	//the left wall is on the side of the next column and the top wall on the side of the next row, see PlaceWalls
+	for (const FIntPoint& door : Settings.DoorTiles)
+	{
+		if (door.X < 0 || door.X >= TileRows || door.Y < 0 || door.Y >= TileRows)
+			continue;
+
+		FTile& tile = TileArray[door.Y * TileRows + door.X];
+		if (door.X == TileRows - 1)
+			tile.wallMask &= ~(1 << uint8(EDungeonObjectAlign::LEFT));
+		if (door.X == 0)
+			tile.wallMask &= ~(1 << uint8(EDungeonObjectAlign::RIGHT));
+		if (door.Y == TileRows - 1)
+			tile.wallMask &= ~(1 << uint8(EDungeonObjectAlign::TOP));
+		if (door.Y == 0)
+			tile.wallMask &= ~(1 << uint8(EDungeonObjectAlign::BOTTOM));
+	}
+}
@@ -0,0 +1,32 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "DungeonChunkLayout.h"
+#include "DungeonRandomStream.h"
+
+FBSPDungeonSettings FDungeonChunkLayout::GetChunkSettings(const FBSPDungeonSettings& worldSettings, const FIntPoint& chunk)
+{
+	FBSPDungeonSettings settings = worldSettings;
+	settings.Seed = GetChunkSeed(worldSettings.Seed, chunk);
+
+	//the left and bottom doors are the right and top doors of the neighbours
+	const int tileRows = worldSettings.DungeonSize / worldSettings.TileSize;
+	settings.DoorTiles.Reset(4);
+	settings.DoorTiles.Add(FIntPoint(tileRows - 1, GetEdgeDoor(worldSettings.Seed, chunk, true, tileRows)));
+	settings.DoorTiles.Add(FIntPoint(0, GetEdgeDoor(worldSettings.Seed, chunk - FIntPoint(1, 0), true, tileRows)));
+	settings.DoorTiles.Add(FIntPoint(GetEdgeDoor(worldSettings.Seed, chunk, false, tileRows), tileRows - 1));
+	settings.DoorTiles.Add(FIntPoint(GetEdgeDoor(worldSettings.Seed, chunk - FIntPoint(0, 1), false, tileRows), 0));
+	return settings;
+}
+
+int32 FDungeonChunkLayout::GetChunkSeed(int32 worldSeed, const FIntPoint& chunk)
+{
+	FDungeonRandomStream chunkStream = FDungeonRandomStream(worldSeed).Split(ChunkStreamID).Split(uint32(chunk.X)).Split(uint32(chunk.Y));
+	return int32(chunkStream.GetUnsignedInt());
+}
+
+int FDungeonChunkLayout::GetEdgeDoor(int32 worldSeed, const FIntPoint& chunk, bool isVerticalEdge, int tileRows)
+{
+	FDungeonRandomStream edgeStream = FDungeonRandomStream(worldSeed).Split(isVerticalEdge ? VerticalEdgeStreamID : HorizontalEdgeStreamID).Split(uint32(chunk.X)).Split(uint32(chunk.Y));
+	return edgeStream.RandRange(1, FMath::Max(tileRows - 2, 1));
+}
@@ -0,0 +1,8 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "DungeonGenerationCore.h"
+#include "Modules/ModuleManager.h"
+
+DEFINE_LOG_CATEGORY(LogDungeonGeneration);
+
+IMPLEMENT_MODULE(FDefaultModuleImpl, DungeonGenerationCore);
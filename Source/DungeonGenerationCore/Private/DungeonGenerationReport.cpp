@@ -0,0 +1,130 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "DungeonGenerationReport.h"
+#include "HAL/PlatformTime.h"
+#include "HAL/FileManager.h"
+#include "Misc/FileHelper.h"
+
+void FDungeonGenerationReport::Reset(const TCHAR* generatorName, int seed)
+{
+	GeneratorName = generatorName;
+	Seed = seed;
+	Phases.Reset();
+	Counters.Reset();
+}
+
+void FDungeonGenerationReport::AddPhase(const TCHAR* name, double milliseconds)
+{
+	Phases.Add({ name, milliseconds });
+}
+
+void FDungeonGenerationReport::SetCounter(const TCHAR* name, int64 value)
+{
+	for (auto& counter : Counters)
+	{
+		if (counter.Name == name) {
+			counter.Value = value;
+			return;
+		}
+	}
+	Counters.Add({ name, value });
+}
+
+int64 FDungeonGenerationReport::GetCounter(const TCHAR* name) const
+{
+	for (auto& counter : Counters)
+	{
+		if (counter.Name == name)
+			return counter.Value;
+	}
+	return 0;
+}
+
+double FDungeonGenerationReport::GetPhaseMilliseconds(const TCHAR* name) const
+{
+	for (auto& phase : Phases)
+	{
+		if (phase.Name == name)
+			return phase.Milliseconds;
+	}
+	return 0.0;
+}
+
+double FDungeonGenerationReport::GetTotalMilliseconds() const
+{
+	double total = 0.0;
+	for (auto& phase : Phases)
+	{
+		total += phase.Milliseconds;
+	}
+	return total;
+}
+
+FString FDungeonGenerationReport::ToJson() const
+{
+	//The names are plain identifiers, nothing has to be escaped
+	FString json = FString::Printf(TEXT("{\"generator\":\"%s\",\"seed\":%d,\"totalMs\":%.4f,\"phases\":{"), *GeneratorName, Seed, GetTotalMilliseconds());
+	for (int i = 0; i < Phases.Num(); i++)
+	{
+		json.Appendf(TEXT("%s\"%s\":%.4f"), i > 0 ? TEXT(",") : TEXT(""), *Phases[i].Name, Phases[i].Milliseconds);
+	}
+	json.Append(TEXT("},\"counters\":{"));
+	for (int i = 0; i < Counters.Num(); i++)
+	{
+		json.Appendf(TEXT("%s\"%s\":%lld"), i > 0 ? TEXT(",") : TEXT(""), *Counters[i].Name, Counters[i].Value);
+	}
+	json.Append(TEXT("}}"));
+	return json;
+}
+
+FString FDungeonGenerationReport::ToCsvHeader() const
+{
+	FString header = TEXT("generator,seed,totalMs");
+	for (auto& phase : Phases)
+	{
+		header.Appendf(TEXT(",%sMs"), *phase.Name);
+	}
+	for (auto& counter : Counters)
+	{
+		header.Appendf(TEXT(",%s"), *counter.Name);
+	}
+	return header;
+}
+
+FString FDungeonGenerationReport::ToCsvRow() const
+{
+	FString row = FString::Printf(TEXT("%s,%d,%.4f"), *GeneratorName, Seed, GetTotalMilliseconds());
+	for (auto& phase : Phases)
+	{
+		row.Appendf(TEXT(",%.4f"), phase.Milliseconds);
+	}
+	for (auto& counter : Counters)
+	{
+		row.Appendf(TEXT(",%lld"), counter.Value);
+	}
+	return row;
+}
+
+bool FDungeonGenerationReport::AppendToCsvFile(const FString& filePath) const
+{
+	FString lines{};
+	if (IFileManager::Get().FileSize(*filePath) <= 0)
+		lines.Append(ToCsvHeader()).Append(LINE_TERMINATOR);
+	lines.Append(ToCsvRow()).Append(LINE_TERMINATOR);
+
+	return FFileHelper::SaveStringToFile(lines, *filePath, FFileHelper::EEncodingOptions::ForceUTF8WithoutBOM, &IFileManager::Get(), FILEWRITE_Append);
+}
+
+FDungeonGenerationPhaseScope::FDungeonGenerationPhaseScope(FDungeonGenerationReport& report, const TCHAR* name)
+	:Report(report)
+	, Name(name)
+	, StartTime(FPlatformTime::Seconds())
+{
+
+}
+
+FDungeonGenerationPhaseScope::~FDungeonGenerationPhaseScope()
+{
+	Report.AddPhase(Name, (FPlatformTime::Seconds() - StartTime) * 1000.0);
+}
@@ -0,0 +1,329 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "DungeonLayoutCache.h"
+#include "DungeonGenerationCore.h"
+#include "HAL/FileManager.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Misc/Guid.h"
+#include "Misc/ScopeLock.h"
+#include "Serialization/MemoryWriter.h"
+#include "Serialization/MemoryReader.h"
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Layout cache hits"), STAT_LayoutCacheHits, STATGROUP_DungeonGeneration);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Layout cache misses"), STAT_LayoutCacheMisses, STATGROUP_DungeonGeneration);
+DECLARE_MEMORY_STAT(TEXT("Layout cache memory"), STAT_LayoutCacheMemory, STATGROUP_DungeonGeneration);
+
+FDungeonLayoutCache::FDungeonLayoutCache(const FString& directory)
+	:Directory(directory)
+{
+
+}
+
+FDungeonLayoutCache& FDungeonLayoutCache::Get()
+{
+	static FDungeonLayoutCache cache(FPaths::ProjectSavedDir() / TEXT("DungeonGeneration") / TEXT("LayoutCache"));
+	return cache;
+}
+
+FSHAHash FDungeonLayoutCache::GetKey(const FBSPDungeonSettings& settings, const FVector& meshScale)
+{
+	FBSPDungeonSettings keySettings = settings;
+	FVector keyScale = meshScale;
+	FString generatorName = TEXT("BSP");
+	int32 keyVersion = KeyVersion;
+
+	TArray<uint8> keyBytes{};
+	FMemoryWriter ar(keyBytes);
+	ar << keyVersion << generatorName << keySettings.Seed << keySettings.DungeonSize << keySettings.SplitIterations << keySettings.TileSize;
+	ar << keySettings.MinTilesPerRoom << keySettings.MinRoomRatio << keySettings.WallTileWidth << keySettings.DoorTiles << keyScale;
+	return GetKey(keyBytes);
+}
+
+FSHAHash FDungeonLayoutCache::GetKey(const FRRPDungeonSettings& settings)
+{
+	FRRPDungeonSettings keySettings = settings;
+	FString generatorName = TEXT("RRP");
+	int32 keyVersion = KeyVersion;
+	uint8 heuresticCostFunction = uint8(keySettings.HeuresticCostFunction);
+	uint8 seperationMode = uint8(keySettings.SeperationMode);
+	uint8 corridorType = uint8(keySettings.CorridorType);
+	uint8 pathfindingMode = uint8(keySettings.PathfindingMode);
+	uint8 pathfindingAlgorithm = uint8(keySettings.PathfindingAlgorithm);
+
+	TArray<uint8> keyBytes{};
+	FMemoryWriter ar(keyBytes);
+	ar << keyVersion << generatorName << keySettings.Seed << keySettings.DungeonCentralPosition << keySettings.DungeonRadius << keySettings.RoomTileSize;
+	ar << keySettings.MinRoomTiles << keySettings.MaxRoomTiles << keySettings.NrOfRooms;
+	ar << keySettings.EmptyTileConnectionCost << keySettings.CorridorConnectionCost << keySettings.RoomConnectionCost << heuresticCostFunction;
+	ar << seperationMode << keySettings.MaxSeperationIterations << corridorType << keySettings.ExtraConnectionFraction;
+	ar << keySettings.SearchWindowMargin << pathfindingMode << pathfindingAlgorithm << keySettings.ClusterSize;
+	int32 nrOfPremadeRooms = keySettings.PremadeRooms.Num();
+	ar << nrOfPremadeRooms;
+	for (FRRPRoom& room : keySettings.PremadeRooms)
+	{
+		ar << room.RoomID << room.Width << room.Height << room.CentralPosition;
+	}
+	return GetKey(keyBytes);
+}
+
+FSHAHash FDungeonLayoutCache::GetKey(const TArray<uint8>& keyBytes)
+{
+	FSHAHash key{};
+	FSHA1::HashBuffer(keyBytes.GetData(), keyBytes.Num(), key.Hash);
+	return key;
+}
+
+bool FDungeonLayoutCache::Find(const FSHAHash& key, FDungeonMeshInstances& outMeshes)
+{
+	TSharedPtr<const FDungeonMeshInstances, ESPMode::ThreadSafe> memoryMeshes = nullptr;
+	bool isOnDisk = false;
+	{
+		FScopeLock scopeLock(&Lock);
+		if (FMemoryEntry* memoryEntry = MemoryEntries.Find(key))
+		{
+			memoryEntry->LastUsed = ++MemoryUseCounter;
+			memoryMeshes = memoryEntry->Meshes;
+			Stats.MemoryHits++;
+			INC_DWORD_STAT(STAT_LayoutCacheHits);
+		}
+		else
+		{
+			ScanDisk();
+			isOnDisk = DiskEntries.Contains(key);
+		}
+	}
+	if (memoryMeshes.IsValid())
+	{
+		outMeshes = *memoryMeshes;
+		return true;
+	}
+
+	//the file is read without the lock, so other threads can use the memory tier in the meantime
+	TSharedPtr<FDungeonMeshInstances, ESPMode::ThreadSafe> diskMeshes = nullptr;
+	const FString filePath = GetFilePath(key);
+	TArray<uint8> fileBytes{};
+	if (isOnDisk && FFileHelper::LoadFileToArray(fileBytes, *filePath, FILEREAD_Silent))
+	{
+		diskMeshes = MakeShared<FDungeonMeshInstances, ESPMode::ThreadSafe>();
+		FSHAHash fileKey{};
+		FMemoryReader ar(fileBytes);
+		SerializeMeshes(ar, fileKey, *diskMeshes);
+		if (ar.IsError() || !(fileKey == key))
+			diskMeshes.Reset();
+	}
+
+	FScopeLock scopeLock(&Lock);
+	if (!diskMeshes.IsValid())
+	{
+		//a file of an older version or a broken file is not read again
+		if (isOnDisk)
+			RemoveFromDisk(key);
+		Stats.Misses++;
+		INC_DWORD_STAT(STAT_LayoutCacheMisses);
+		return false;
+	}
+
+	const int64 now = FDateTime::UtcNow().GetTicks();
+	if (FDiskEntry* diskEntry = DiskEntries.Find(key))
+		diskEntry->LastUsed = now;
+	IFileManager::Get().SetTimeStamp(*filePath, FDateTime(now));
+	Stats.DiskHits++;
+	INC_DWORD_STAT(STAT_LayoutCacheHits);
+	outMeshes = *diskMeshes;
+	AddToMemory(key, diskMeshes, GetAllocatedBytes(*diskMeshes));
+	return true;
+}
+
+void FDungeonLayoutCache::Add(const FSHAHash& key, const FDungeonMeshInstances& meshes)
+{
+	TSharedPtr<FDungeonMeshInstances, ESPMode::ThreadSafe> sharedMeshes = MakeShared<FDungeonMeshInstances, ESPMode::ThreadSafe>(meshes);
+	bool isWritingFile = false;
+	{
+		FScopeLock scopeLock(&Lock);
+		AddToMemory(key, sharedMeshes, GetAllocatedBytes(meshes));
+		ScanDisk();
+		isWritingFile = MaxDiskBytes > 0 && !DiskEntries.Contains(key);
+	}
+	if (!isWritingFile)
+		return;
+
+	//written to a file of its own first, a thread that reads the same key never sees half a file
+	TArray<uint8> fileBytes{};
+	FMemoryWriter ar(fileBytes);
+	FSHAHash fileKey = key;
+	SerializeMeshes(ar, fileKey, *sharedMeshes);
+	const FString filePath = GetFilePath(key);
+	const FString tempFilePath = filePath + TEXT(".") + FGuid::NewGuid().ToString() + TEXT(".tmp");
+	if (!FFileHelper::SaveArrayToFile(fileBytes, *tempFilePath) || !IFileManager::Get().Move(*filePath, *tempFilePath, true, true))
+	{
+		IFileManager::Get().Delete(*tempFilePath, false, false, true);
+		UE_LOG(LogDungeonGeneration, Warning, TEXT("Could not write %s to the layout cache"), *filePath);
+		return;
+	}
+
+	FScopeLock scopeLock(&Lock);
+	if (!DiskEntries.Contains(key))
+	{
+		DiskEntries.Add(key, FDiskEntry{ fileBytes.Num(), FDateTime::UtcNow().GetTicks() });
+		Stats.DiskBytes += fileBytes.Num();
+	}
+	EvictDisk();
+}
+
+void FDungeonLayoutCache::SetLimits(int64 maxMemoryBytes, int64 maxDiskBytes)
+{
+	FScopeLock scopeLock(&Lock);
+	MaxMemoryBytes = FMath::Max<int64>(maxMemoryBytes, 0);
+	MaxDiskBytes = FMath::Max<int64>(maxDiskBytes, 0);
+	EvictMemory();
+	if (IsDiskScanned)
+		EvictDisk();
+}
+
+void FDungeonLayoutCache::Empty()
+{
+	FScopeLock scopeLock(&Lock);
+	MemoryEntries.Empty();
+	Stats.MemoryBytes = 0;
+	ScanDisk();
+	TArray<FSHAHash> diskKeys{};
+	DiskEntries.GetKeys(diskKeys);
+	for (const FSHAHash& key : diskKeys)
+	{
+		RemoveFromDisk(key);
+	}
+	SET_MEMORY_STAT(STAT_LayoutCacheMemory, Stats.MemoryBytes);
+}
+
+void FDungeonLayoutCache::AddCounters(FDungeonGenerationReport& report) const
+{
+	const FDungeonLayoutCacheStats stats = GetStats();
+	report.SetCounter(TEXT("CacheMemoryHits"), stats.MemoryHits);
+	report.SetCounter(TEXT("CacheDiskHits"), stats.DiskHits);
+	report.SetCounter(TEXT("CacheMisses"), stats.Misses);
+	report.SetCounter(TEXT("CacheEvictions"), stats.MemoryEvictions + stats.DiskEvictions);
+	report.SetCounter(TEXT("CacheMemoryBytes"), stats.MemoryBytes);
+	report.SetCounter(TEXT("CacheDiskBytes"), stats.DiskBytes);
+}
+
+FDungeonLayoutCacheStats FDungeonLayoutCache::GetStats() const
+{
+	FScopeLock scopeLock(&Lock);
+	FDungeonLayoutCacheStats stats = Stats;
+	stats.NrOfMemoryEntries = MemoryEntries.Num();
+	stats.NrOfDiskEntries = DiskEntries.Num();
+	return stats;
+}
+
+int64 FDungeonLayoutCache::GetAllocatedBytes(const FDungeonMeshInstances& meshes)
+{
+	return meshes.FloorTransforms.GetAllocatedSize() + meshes.FloorCustomData.GetAllocatedSize() + meshes.WallTransforms.GetAllocatedSize() + meshes.WallCustomData.GetAllocatedSize();
+}
+
+void FDungeonLayoutCache::SerializeMeshes(FArchive& ar, FSHAHash& key, FDungeonMeshInstances& meshes)
+{
+	uint32 magic = FileMagic;
+	int32 version = FileVersion;
+	ar << magic << version;
+	if (magic != FileMagic || version != FileVersion)
+	{
+		ar.SetError();
+		return;
+	}
+	ar << key;
+	ar << meshes.FloorTransforms << meshes.FloorCustomData << meshes.WallTransforms << meshes.WallCustomData;
+}
+
+FString FDungeonLayoutCache::GetFilePath(const FSHAHash& key) const
+{
+	return Directory / key.ToString() + TEXT(".dgc");
+}
+
+void FDungeonLayoutCache::ScanDisk()
+{
+	if (IsDiskScanned)
+		return;
+	IsDiskScanned = true;
+
+	//the files of earlier sessions, their time stamp is the last time they were used
+	TArray<FString> fileNames{};
+	IFileManager::Get().FindFiles(fileNames, *(Directory / TEXT("*.dgc")), true, false);
+	for (const FString& fileName : fileNames)
+	{
+		const FString keyString = FPaths::GetBaseFilename(fileName);
+		if (keyString.Len() != 40)
+			continue;
+
+		FSHAHash key{};
+		key.FromString(keyString);
+		const FString filePath = Directory / fileName;
+		const int64 fileSize = IFileManager::Get().FileSize(*filePath);
+		DiskEntries.Add(key, FDiskEntry{ fileSize, IFileManager::Get().GetTimeStamp(*filePath).GetTicks() });
+		Stats.DiskBytes += fileSize;
+	}
+	EvictDisk();
+}
+
+void FDungeonLayoutCache::AddToMemory(const FSHAHash& key, const TSharedPtr<const FDungeonMeshInstances, ESPMode::ThreadSafe>& meshes, int64 bytes)
+{
+	if (bytes > MaxMemoryBytes)
+		return;
+
+	if (FMemoryEntry* memoryEntry = MemoryEntries.Find(key))
+		Stats.MemoryBytes -= memoryEntry->Bytes;
+	MemoryEntries.Add(key, FMemoryEntry{ meshes, bytes, ++MemoryUseCounter });
+	Stats.MemoryBytes += bytes;
+	EvictMemory();
+	SET_MEMORY_STAT(STAT_LayoutCacheMemory, Stats.MemoryBytes);
+}
+
+void FDungeonLayoutCache::EvictMemory()
+{
+	//the least recently used dungeon is searched every eviction, the cache holds a few dungeons of many instances each
+	while (Stats.MemoryBytes > MaxMemoryBytes && MemoryEntries.Num() > 0)
+	{
+		FSHAHash leastRecentlyUsedKey = MemoryEntries.CreateConstIterator().Key();
+		uint64 leastRecentlyUsed = MAX_uint64;
+		for (auto& elem : MemoryEntries)
+		{
+			if (elem.Value.LastUsed < leastRecentlyUsed)
+			{
+				leastRecentlyUsed = elem.Value.LastUsed;
+				leastRecentlyUsedKey = elem.Key;
+			}
+		}
+		Stats.MemoryBytes -= MemoryEntries.FindAndRemoveChecked(leastRecentlyUsedKey).Bytes;
+		Stats.MemoryEvictions++;
+	}
+}
+
+void FDungeonLayoutCache::EvictDisk()
+{
+	while (Stats.DiskBytes > MaxDiskBytes && DiskEntries.Num() > 0)
+	{
+		FSHAHash leastRecentlyUsedKey = DiskEntries.CreateConstIterator().Key();
+		int64 leastRecentlyUsed = MAX_int64;
+		for (auto& elem : DiskEntries)
+		{
+			if (elem.Value.LastUsed < leastRecentlyUsed)
+			{
+				leastRecentlyUsed = elem.Value.LastUsed;
+				leastRecentlyUsedKey = elem.Key;
+			}
+		}
+		RemoveFromDisk(leastRecentlyUsedKey);
+		Stats.DiskEvictions++;
+	}
+}
+
+void FDungeonLayoutCache::RemoveFromDisk(const FSHAHash& key)
+{
+	FDiskEntry diskEntry{};
+	if (!DiskEntries.RemoveAndCopyValue(key, diskEntry))
+		return;
+
+	Stats.DiskBytes -= diskEntry.Bytes;
+	IFileManager::Get().Delete(*GetFilePath(key), false, false, true);
+}
@@ -0,0 +1,183 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "DungeonLayoutFile.h"
+#include "DungeonGenerationCore.h"
+#include "HAL/PlatformFilemanager.h"
+#include "Async/MappedFileHandle.h"
+#include "Misc/FileHelper.h"
+
+static_assert(PLATFORM_LITTLE_ENDIAN, "The dungeon layout file is read in place and stored little endian");
+static_assert(sizeof(FDungeonLayoutHeader) == 72, "The header of the dungeon layout file changed size, bump the version");
+static_assert(sizeof(FIntRect) == 16 && sizeof(FIntPoint) == 8, "The rooms and doors of the dungeon layout file changed size, bump the version");
+
+namespace
+{
+	uint64 AlignOffset(uint64 offset)
+	{
+		return Align(offset, uint64(8));
+	}
+
+	bool IsBlockInFile(uint64 offset, uint64 size, uint64 fileSize)
+	{
+		return offset % 8 == 0 && offset <= fileSize && size <= fileSize - offset;
+	}
+}
+
+void FDungeonLayoutFile::Write(const FBSPDungeonGenerator& generator, TArray<uint8>& outBytes)
+{
+	const TArray<FTile>& tiles = generator.GetTiles();
+	const FBSPDungeonSettings& settings = generator.GetSettings();
+	TArray<FIntRect> rooms{};
+	generator.GetRoomTileRects(rooms);
+
+	FDungeonLayoutHeader header{};
+	header.Magic = Magic;
+	header.Version = Version;
+	header.HeaderSize = sizeof(FDungeonLayoutHeader);
+	header.Seed = settings.Seed;
+	header.TileRows = generator.GetTileRows();
+	header.TileSize = settings.TileSize;
+	header.WallTileWidth = settings.WallTileWidth;
+	header.NrOfRooms = rooms.Num();
+	header.NrOfDoors = settings.DoorTiles.Num();
+	header.TileTypesOffset = AlignOffset(sizeof(FDungeonLayoutHeader));
+	header.WallMasksOffset = AlignOffset(header.TileTypesOffset + tiles.Num());
+	header.RoomsOffset = AlignOffset(header.WallMasksOffset + tiles.Num());
+	header.DoorsOffset = AlignOffset(header.RoomsOffset + rooms.Num() * sizeof(FIntRect));
+	header.FileSize = header.DoorsOffset + settings.DoorTiles.Num() * sizeof(FIntPoint);
+
+	//the padding between the blocks stays 0, so the same layout always gives the same bytes
+	outBytes.Reset();
+	outBytes.SetNumZeroed(header.FileSize);
+	uint8* bytes = outBytes.GetData();
+	FMemory::Memcpy(bytes, &header, sizeof(FDungeonLayoutHeader));
+	uint8* tileTypes = bytes + header.TileTypesOffset;
+	uint8* wallMasks = bytes + header.WallMasksOffset;
+	for (int tileIndex = 0; tileIndex < tiles.Num(); tileIndex++)
+	{
+		tileTypes[tileIndex] = uint8(tiles[tileIndex].tileType);
+		wallMasks[tileIndex] = tiles[tileIndex].wallMask;
+	}
+	FMemory::Memcpy(bytes + header.RoomsOffset, rooms.GetData(), rooms.Num() * sizeof(FIntRect));
+	FMemory::Memcpy(bytes + header.DoorsOffset, settings.DoorTiles.GetData(), settings.DoorTiles.Num() * sizeof(FIntPoint));
+}
+
+bool FDungeonLayoutFile::SaveToFile(const FBSPDungeonGenerator& generator, const FString& fileName)
+{
+	TArray<uint8> bytes{};
+	Write(generator, bytes);
+	return FFileHelper::SaveArrayToFile(bytes, *fileName);
+}
+
+const FDungeonLayoutHeader* FDungeonLayoutFile::GetHeader(const uint8* bytes, int64 nrOfBytes)
+{
+	if (bytes == nullptr || nrOfBytes < int64(sizeof(FDungeonLayoutHeader)))
+		return nullptr;
+
+	const FDungeonLayoutHeader* header = reinterpret_cast<const FDungeonLayoutHeader*>(bytes);
+	//a newer version has at least the fields of this version, its own fields are after them
+	if (header->Magic != Magic || header->Version == 0 || header->HeaderSize < sizeof(FDungeonLayoutHeader))
+		return nullptr;
+	if (header->Version == Version && header->HeaderSize != sizeof(FDungeonLayoutHeader))
+		return nullptr;
+	if (header->FileSize > uint64(nrOfBytes) || header->TileRows < 0 || header->TileSize <= 0 || header->NrOfRooms < 0 || header->NrOfDoors < 0)
+		return nullptr;
+
+	const uint64 nrOfTiles = uint64(header->TileRows) * uint64(header->TileRows);
+	if (!IsBlockInFile(header->TileTypesOffset, nrOfTiles, header->FileSize)
+		|| !IsBlockInFile(header->WallMasksOffset, nrOfTiles, header->FileSize)
+		|| !IsBlockInFile(header->RoomsOffset, uint64(header->NrOfRooms) * sizeof(FIntRect), header->FileSize)
+		|| !IsBlockInFile(header->DoorsOffset, uint64(header->NrOfDoors) * sizeof(FIntPoint), header->FileSize))
+		return nullptr;
+
+	//the tile types are cast to ETileType when the meshes are made, a corrupt byte would be an unknown type
+	const uint8* tileTypes = bytes + header->TileTypesOffset;
+	for (uint64 tileIndex = 0; tileIndex < nrOfTiles; tileIndex++)
+	{
+		if (tileTypes[tileIndex] > uint8(ETileType::CORRIDOR))
+			return nullptr;
+	}
+	return header;
+}
+
+FMappedDungeonLayout::FMappedDungeonLayout()
+{
+
+}
+
+FMappedDungeonLayout::~FMappedDungeonLayout()
+{
+	Close();
+}
+
+bool FMappedDungeonLayout::Open(const FString& fileName)
+{
+	Close();
+
+	int64 nrOfBytes = 0;
+	MappedFile.Reset(FPlatformFileManager::Get().GetPlatformFile().OpenMapped(*fileName));
+	if (MappedFile.IsValid() && MappedFile->GetFileSize() > 0)
+	{
+		MappedRegion.Reset(MappedFile->MapRegion(0, MappedFile->GetFileSize()));
+		if (MappedRegion.IsValid())
+		{
+			Bytes = MappedRegion->GetMappedPtr();
+			nrOfBytes = MappedRegion->GetMappedSize();
+		}
+	}
+	if (Bytes == nullptr)
+	{
+		MappedRegion.Reset();
+		MappedFile.Reset();
+		if (FFileHelper::LoadFileToArray(LoadedBytes, *fileName, FILEREAD_Silent))
+		{
+			Bytes = LoadedBytes.GetData();
+			nrOfBytes = LoadedBytes.Num();
+		}
+	}
+
+	Header = FDungeonLayoutFile::GetHeader(Bytes, nrOfBytes);
+	if (Header == nullptr)
+	{
+		UE_LOG(LogDungeonGeneration, Warning, TEXT("%s is not a valid dungeon layout file (version %d)"), *fileName, FDungeonLayoutFile::Version);
+		Close();
+		return false;
+	}
+	return true;
+}
+
+void FMappedDungeonLayout::Close()
+{
+	Header = nullptr;
+	Bytes = nullptr;
+	//the region has to be unmapped before its file is closed
+	MappedRegion.Reset();
+	MappedFile.Reset();
+	LoadedBytes.Empty();
+}
+
+FDungeonTilePlanes FMappedDungeonLayout::GetTilePlanes() const
+{
+	FDungeonTilePlanes planes{};
+	planes.TileTypes = Bytes + GetHeader().TileTypesOffset;
+	planes.WallMasks = Bytes + GetHeader().WallMasksOffset;
+	planes.Stride = 1;
+	planes.TileRows = GetHeader().TileRows;
+	return planes;
+}
+
+TArrayView<const FIntRect> FMappedDungeonLayout::GetRooms() const
+{
+	return TArrayView<const FIntRect>(reinterpret_cast<const FIntRect*>(Bytes + GetHeader().RoomsOffset), GetHeader().NrOfRooms);
+}
+
+TArrayView<const FIntPoint> FMappedDungeonLayout::GetDoors() const
+{
+	return TArrayView<const FIntPoint>(reinterpret_cast<const FIntPoint*>(Bytes + GetHeader().DoorsOffset), GetHeader().NrOfDoors);
+}
+
+void FMappedDungeonLayout::GetMeshInstances(const FTransform& baseTransform, FDungeonMeshInstances& outMeshes) const
+{
+	FBSPDungeonGenerator::GetMeshInstances(GetTilePlanes(), GetHeader().TileSize, GetHeader().WallTileWidth, baseTransform, outMeshes);
+}
@@ -0,0 +1,59 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "DungeonRandomStream.h"
+
+FDungeonRandomStream::FDungeonRandomStream()
+	:Key(Mix(0))
+	, Counter(0)
+{
+
+}
+
+FDungeonRandomStream::FDungeonRandomStream(int32 seed)
+	:Key(Mix(uint64(uint32(seed))))
+	, Counter(0)
+{
+
+}
+
+FDungeonRandomStream FDungeonRandomStream::Split(uint32 streamID) const
+{
+	FDungeonRandomStream substream{};
+	substream.Key = Mix(Key ^ Mix(uint64(streamID) + GoldenGamma));
+	return substream;
+}
+
+uint32 FDungeonRandomStream::GetUnsignedInt()
+{
+	Counter++;
+	return uint32(Mix(Key + Counter * GoldenGamma) >> 32);
+}
+
+float FDungeonRandomStream::GetFraction()
+{
+	//24 bits fit exactly in the mantissa, the result is in [0, 1)
+	return float(GetUnsignedInt() >> 8) / 16777216.f;
+}
+
+int32 FDungeonRandomStream::RandRange(int32 min, int32 max)
+{
+	const int64 range = int64(max) - int64(min) + 1;
+	if (range <= 0)
+		return min;
+
+	return int32(min + int64((uint64(GetUnsignedInt()) * uint64(range)) >> 32));
+}
+
+float FDungeonRandomStream::FRandRange(float min, float max)
+{
+	return min + (max - min) * GetFraction();
+}
+
+uint64 FDungeonRandomStream::Mix(uint64 value)
+{
+	//SplitMix64 finalizer
+	value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ull;
+	value = (value ^ (value >> 27)) * 0x94D049BB133111EBull;
+	return value ^ (value >> 31);
+}
@@ -0,0 +1,2271 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "RRPDungeonGenerator.h"
+#include "DungeonGenerationCore.h"
+#include "Async/ParallelFor.h"
+#include "Algo/Reverse.h"
+
+DECLARE_CYCLE_STAT(TEXT("RRP GenerateDungeon"), STAT_RRPGenerateDungeon, STATGROUP_DungeonGeneration);
+DECLARE_CYCLE_STAT(TEXT("RRP GenerateRooms"), STAT_RRPGenerateRooms, STATGROUP_DungeonGeneration);
+DECLARE_CYCLE_STAT(TEXT("RRP ContructTileNodeGrid"), STAT_RRPContructTileNodeGrid, STATGROUP_DungeonGeneration);
+DECLARE_CYCLE_STAT(TEXT("RRP AttachTileNodesToRooms"), STAT_RRPAttachTileNodesToRooms, STATGROUP_DungeonGeneration);
+DECLARE_CYCLE_STAT(TEXT("RRP BuildClusterGraph"), STAT_RRPBuildClusterGraph, STATGROUP_DungeonGeneration);
+DECLARE_CYCLE_STAT(TEXT("RRP RandomRoomConnect"), STAT_RRPRandomRoomConnect, STATGROUP_DungeonGeneration);
+DECLARE_CYCLE_STAT(TEXT("RRP MinimumSpanningTreeConnect"), STAT_RRPMinimumSpanningTreeConnect, STATGROUP_DungeonGeneration);
+DECLARE_CYCLE_STAT(TEXT("RRP UpdatePremadeRooms"), STAT_RRPUpdatePremadeRooms, STATGROUP_DungeonGeneration);
+DECLARE_CYCLE_STAT(TEXT("RRP GetMeshInstances"), STAT_RRPGetMeshInstances, STATGROUP_DungeonGeneration);
+DECLARE_DWORD_COUNTER_STAT(TEXT("RRP Seperation iterations"), STAT_RRPSeperationIterations, STATGROUP_DungeonGeneration);
+DECLARE_DWORD_COUNTER_STAT(TEXT("RRP A* searches"), STAT_RRPPathSearches, STATGROUP_DungeonGeneration);
+DECLARE_DWORD_COUNTER_STAT(TEXT("RRP A* nodes expanded"), STAT_RRPNodesExpanded, STATGROUP_DungeonGeneration);
+DECLARE_DWORD_COUNTER_STAT(TEXT("RRP A* open list peak size"), STAT_RRPOpenListPeakSize, STATGROUP_DungeonGeneration);
+DECLARE_DWORD_COUNTER_STAT(TEXT("RRP HPA* cluster updates"), STAT_RRPClusterUpdates, STATGROUP_DungeonGeneration);
+
+FRRPDungeonGenerator::FRRPDungeonGenerator(const FRRPDungeonSettings& settings)
+	:Settings(settings)
+	, RandomStream(settings.Seed)
+{
+
+}
+
+bool FRRPDungeonGenerator::GenerateDungeon()
+{
+	SCOPE_CYCLE_COUNTER(STAT_RRPGenerateDungeon);
+	Report.Reset(TEXT("RRP"), Settings.Seed);
+	PathSearch = FTileNodeSearch();
+	NrOfRoomConnections = 0;
+	NrOfPathConflicts = 0;
+	NrOfClusterUpdates = 0;
+	ClusterGraph.Empty();
+
+	//TileNodes
+	{
+		SCOPE_CYCLE_COUNTER(STAT_RRPGenerateRooms);
+		FDungeonGenerationPhaseScope phaseScope(Report, TEXT("GenerateRooms"));
+		GenerateRooms();
+	}
+	if (IsCancelled())
+		return false;
+	{
+		SCOPE_CYCLE_COUNTER(STAT_RRPContructTileNodeGrid);
+		FDungeonGenerationPhaseScope phaseScope(Report, TEXT("ContructTileNodeGrid"));
+		ContructTileNodeGrid();
+	}
+	{
+		SCOPE_CYCLE_COUNTER(STAT_RRPAttachTileNodesToRooms);
+		FDungeonGenerationPhaseScope phaseScope(Report, TEXT("AttachTileNodesToRooms"));
+		AttachTileNodesToRooms();
+	}
+	if (Settings.PathfindingAlgorithm == ERRPPathfindingAlgorithm::HIERARCHICAL)
+	{
+		SCOPE_CYCLE_COUNTER(STAT_RRPBuildClusterGraph);
+		FDungeonGenerationPhaseScope phaseScope(Report, TEXT("BuildClusterGraph"));
+		ClusterGraph.Build(TileNodeGrid, Settings.ClusterSize, PathSearch.OpenList, PathSearch.StartClusterCosts);
+	}
+
+	//Corridors
+	if (Settings.CorridorType == ERRPCorridorType::MINIMUMSPANNINGTREE)
+	{
+		SCOPE_CYCLE_COUNTER(STAT_RRPMinimumSpanningTreeConnect);
+		FDungeonGenerationPhaseScope phaseScope(Report, TEXT("MinimumSpanningTreeConnect"));
+		MinimumSpanningTreeConnect();
+	}
+	else
+	{
+		SCOPE_CYCLE_COUNTER(STAT_RRPRandomRoomConnect);
+		FDungeonGenerationPhaseScope phaseScope(Report, TEXT("RandomRoomConnect"));
+		RandomRoomConnect();
+	}
+	if (IsCancelled())
+		return false;
+
+	Report.SetCounter(TEXT("Rooms"), ArrayOfRooms.Num());
+	Report.SetCounter(TEXT("SeperationIterations"), NrOfSeperationIterations);
+	Report.SetCounter(TEXT("TileNodes"), TileNodeGrid.Num());
+	Report.SetCounter(TEXT("Corridors"), CorridorTiles.Num());
+	Report.SetCounter(TEXT("RoomConnections"), NrOfRoomConnections);
+	Report.SetCounter(TEXT("PathConflicts"), NrOfPathConflicts);
+	Report.SetCounter(TEXT("SearchWindowFallbacks"), PathSearch.NrOfSearchWindowFallbacks);
+	Report.SetCounter(TEXT("PathSearches"), PathSearch.NrOfPathSearches);
+	Report.SetCounter(TEXT("NodesExpanded"), PathSearch.NrOfNodesExpanded);
+	Report.SetCounter(TEXT("OpenListPeakSize"), PathSearch.OpenListPeakSize);
+	Report.SetCounter(TEXT("PathCost"), FMath::RoundToInt(PathSearch.TotalPathCost));
+	Report.SetCounter(TEXT("ClusterEntrances"), ClusterGraph.EntranceNodeIDs.Num());
+	Report.SetCounter(TEXT("ClusterUpdates"), NrOfClusterUpdates);
+
+	SET_DWORD_STAT(STAT_RRPSeperationIterations, NrOfSeperationIterations);
+	SET_DWORD_STAT(STAT_RRPPathSearches, PathSearch.NrOfPathSearches);
+	SET_DWORD_STAT(STAT_RRPNodesExpanded, PathSearch.NrOfNodesExpanded);
+	SET_DWORD_STAT(STAT_RRPOpenListPeakSize, PathSearch.OpenListPeakSize);
+	SET_DWORD_STAT(STAT_RRPClusterUpdates, NrOfClusterUpdates);
+	return true;
+}
+
+void FRRPDungeonGenerator::GetMeshInstances(FDungeonMeshInstances& outMeshes) const
+{
+	SCOPE_CYCLE_COUNTER(STAT_RRPGetMeshInstances);
+
+	//Rooms
+	TArray<ETileNodeType> tilesTypesToIgnore = { ETileNodeType::ROOM, ETileNodeType::DOOR };
+	for (auto& currentRoom : ArrayOfRooms)
+	{
+		for (auto nodeID : currentRoom.TileNodesOfRoom)
+		{
+			GetMeshInstancesOfTileNode(nodeID, tilesTypesToIgnore, outMeshes.FloorTransforms, outMeshes.WallTransforms);
+		}
+	}
+
+	//Corridors, a TileNode shared by multiple corridors gets its meshes once
+	tilesTypesToIgnore = { ETileNodeType::CORRIDOR };
+	TArray<uint8> isTileNodeAdded{};
+	isTileNodeAdded.Init(0, TileNodeGrid.Num());
+	for (auto& corridor : CorridorTiles)
+	{
+		for (auto nodeID : corridor.Value)
+		{
+			if (TileNodeGrid.TileNodeTypes[nodeID] == ETileNodeType::CORRIDOR && !isTileNodeAdded[nodeID])
+			{
+				isTileNodeAdded[nodeID] = 1;
+				GetMeshInstancesOfTileNode(nodeID, tilesTypesToIgnore, outMeshes.FloorTransforms, outMeshes.WallTransforms);
+			}
+		}
+	}
+}
+
+void FRRPDungeonGenerator::GetMeshInstancesOfTileNodes(const TArray<int>& nodeIDs, FDungeonMeshInstances& outMeshes) const
+{
+	//Room TileNodes ignore the rooms and doors next to them, the other corridor TileNodes ignore the corridors
+	const TArray<ETileNodeType> roomTypesToIgnore = { ETileNodeType::ROOM, ETileNodeType::DOOR };
+	const TArray<ETileNodeType> corridorTypesToIgnore = { ETileNodeType::CORRIDOR };
+	for (int nodeID : nodeIDs)
+	{
+		if (RoomOfTileNode[nodeID] != INDEX_NONE)
+			GetMeshInstancesOfTileNode(nodeID, roomTypesToIgnore, outMeshes.FloorTransforms, outMeshes.WallTransforms);
+		else if (TileNodeGrid.TileNodeTypes[nodeID] == ETileNodeType::CORRIDOR)
+			GetMeshInstancesOfTileNode(nodeID, corridorTypesToIgnore, outMeshes.FloorTransforms, outMeshes.WallTransforms);
+	}
+}
+
+void FRRPDungeonGenerator::GetTileNodesInBox(const FBox2D& box, TArray<int>& outNodeIDs) const
+{
+	if (TileNodeGrid.Num() == 0)
+		return;
+
+	//The rows go from the bottom (+y) to the top (-y) of the grid, the corners are clamped to the grid
+	const int topLeftNodeID = GetNodeIDFromPosition(FVector(box.Min.X, box.Max.Y, 0.f));
+	const int bottomRightNodeID = GetNodeIDFromPosition(FVector(box.Max.X, box.Min.Y, 0.f));
+	for (int row = topLeftNodeID / NrOfGridCols; row <= bottomRightNodeID / NrOfGridCols; row++)
+	{
+		for (int col = topLeftNodeID % NrOfGridCols; col <= bottomRightNodeID % NrOfGridCols; col++)
+		{
+			outNodeIDs.Add(row * NrOfGridCols + col);
+		}
+	}
+}
+
+bool FRRPDungeonGenerator::UpdatePremadeRooms(const TArray<FRRPRoom>& premadeRooms)
+{
+	SCOPE_CYCLE_COUNTER(STAT_RRPUpdatePremadeRooms);
+	DirtyTileNodes.Reset();
+	if (TileNodeGrid.Num() == 0 || IsCancelled())
+		return false;
+
+	//The grid is not made again, so every room has to fit in it
+	for (auto& room : premadeRooms)
+	{
+		const FVector halfSize{ room.Width / 2.f, room.Height / 2.f, 0.f };
+		if (!IsPositionInGrid(room.CentralPosition - halfSize) || !IsPositionInGrid(room.CentralPosition + halfSize))
+			return false;
+	}
+
+	Report.Reset(TEXT("RRPUpdate"), Settings.Seed);
+	PathSearch = FTileNodeSearch();
+	NrOfRoomConnections = 0;
+	NrOfPathConflicts = 0;
+	NrOfClusterUpdates = 0;
+	if (TilesChangedByUpdate.Num() != TileNodeGrid.Num())
+		TilesChangedByUpdate.Init(0, TileNodeGrid.Num());
+
+	//Premade rooms are matched on RoomID, an unchanged room keeps the position it got from the seperation and its TileNodes.
+	//The premade rooms are the first rooms of ArrayOfRooms, the random rooms after them stay as they are
+	TArray<FRRPRoom> oldRooms = MoveTemp(ArrayOfRooms);
+	ArrayOfRooms.Reset(premadeRooms.Num() + oldRooms.Num());
+	TArray<int> oldToNewRooms{};
+	oldToNewRooms.Init(INDEX_NONE, oldRooms.Num());
+	TArray<uint8> isRoomChanged{};
+	TArray<int> roomTileNodes{};
+	int nrOfChangedRooms = 0;
+	{
+		FDungeonGenerationPhaseScope phaseScope(Report, TEXT("UpdateRooms"));
+		const int nrOfOldPremadeRooms = FMath::Min(Settings.PremadeRooms.Num(), oldRooms.Num());
+		TArray<uint8> isOldRoomMatched{};
+		isOldRoomMatched.Init(0, nrOfOldPremadeRooms);
+		for (auto& room : premadeRooms)
+		{
+			int oldRoomIndex = INDEX_NONE;
+			for (int i = 0; i < nrOfOldPremadeRooms && oldRoomIndex == INDEX_NONE; i++)
+			{
+				if (!isOldRoomMatched[i] && Settings.PremadeRooms[i].RoomID == room.RoomID)
+					oldRoomIndex = i;
+			}
+
+			FRRPRoom newRoom = room;
+			bool isChanged = true;
+			if (oldRoomIndex != INDEX_NONE)
+			{
+				const FRRPRoom& oldPremadeRoom = Settings.PremadeRooms[oldRoomIndex];
+				isOldRoomMatched[oldRoomIndex] = 1;
+				oldToNewRooms[oldRoomIndex] = ArrayOfRooms.Num();
+				isChanged = oldPremadeRoom.Width != room.Width || oldPremadeRoom.Height != room.Height || !oldPremadeRoom.CentralPosition.Equals(room.CentralPosition);
+				if (isChanged)
+				{
+					for (int nodeID : oldRooms[oldRoomIndex].TileNodesOfRoom)
+					{
+						AddChangedTileNode(nodeID);
+					}
+				}
+				else
+					newRoom = oldRooms[oldRoomIndex];
+			}
+
+			//The new area of a changed room, its TileNodes are attached after the old area is cleared
+			if (isChanged)
+			{
+				newRoom.TileNodesOfRoom.Reset();
+				roomTileNodes.Reset();
+				GetTileNodesOfRoom(newRoom, roomTileNodes);
+				for (int nodeID : roomTileNodes)
+				{
+					AddChangedTileNode(nodeID);
+				}
+			}
+
+			ArrayOfRooms.Add(newRoom);
+			isRoomChanged.Add(isChanged);
+			nrOfChangedRooms += isChanged;
+		}
+
+		//Removed rooms
+		for (int i = 0; i < nrOfOldPremadeRooms; i++)
+		{
+			if (isOldRoomMatched[i])
+				continue;
+
+			nrOfChangedRooms++;
+			for (int nodeID : oldRooms[i].TileNodesOfRoom)
+			{
+				AddChangedTileNode(nodeID);
+			}
+		}
+
+		for (int i = nrOfOldPremadeRooms; i < oldRooms.Num(); i++)
+		{
+			oldToNewRooms[i] = ArrayOfRooms.Num();
+			ArrayOfRooms.Add(MoveTemp(oldRooms[i]));
+			isRoomChanged.Add(0);
+		}
+	}
+
+	Settings.PremadeRooms = premadeRooms;
+	if (nrOfChangedRooms == 0)
+		return true;
+
+	//The connections of the rooms as they are now, in the same order as a generation commits them
+	TArray<FRoomConnection> connections{};
+	GetRoomConnections(connections);
+	TMap<uint64, int> keptCorridors{};
+	GetKeptCorridors(connections, oldToNewRooms, isRoomChanged, keptCorridors);
+
+	//Only the area of the changed rooms and of the corridors that are not kept is cleared and stamped again, the rest of the grid stays as it is
+	{
+		FDungeonGenerationPhaseScope phaseScope(Report, TEXT("ClearChangedTileNodes"));
+		ClearChangedTileNodes(oldRooms, oldToNewRooms, isRoomChanged);
+	}
+
+	{
+		FDungeonGenerationPhaseScope phaseScope(Report, TEXT("UpdateCorridors"));
+		UpdateCorridors(connections, keptCorridors);
+	}
+
+	{
+		FDungeonGenerationPhaseScope phaseScope(Report, TEXT("UpdateDirtyTileNodes"));
+		UpdateDirtyTileNodes();
+	}
+	if (IsCancelled())
+		return false;
+
+	//Changed rooms are not seperated, they stay where they were placed. The overlap is found again for the rooms as they are now,
+	//so moving a room away also clears it
+	HasOverlappingRooms = false;
+	for (int roomIndex = 0; roomIndex < ArrayOfRooms.Num() && !HasOverlappingRooms; roomIndex++)
+	{
+		for (int otherRoomIndex = roomIndex + 1; otherRoomIndex < ArrayOfRooms.Num() && !HasOverlappingRooms; otherRoomIndex++)
+		{
+			HasOverlappingRooms = AreRoomsOverlapping(ArrayOfRooms[roomIndex], ArrayOfRooms[otherRoomIndex], 0.f);
+		}
+	}
+	if (HasOverlappingRooms)
+		UE_LOG(LogDungeonGeneration, Warning, TEXT("Rooms overlap after the update of the premade rooms"));
+
+	Report.SetCounter(TEXT("Rooms"), ArrayOfRooms.Num());
+	Report.SetCounter(TEXT("ChangedRooms"), nrOfChangedRooms);
+	Report.SetCounter(TEXT("Corridors"), CorridorTiles.Num());
+	Report.SetCounter(TEXT("RoomConnections"), NrOfRoomConnections);
+	Report.SetCounter(TEXT("PathSearches"), PathSearch.NrOfPathSearches);
+	Report.SetCounter(TEXT("NodesExpanded"), PathSearch.NrOfNodesExpanded);
+	Report.SetCounter(TEXT("ClusterUpdates"), NrOfClusterUpdates);
+	Report.SetCounter(TEXT("DirtyTileNodes"), DirtyTileNodes.Num());
+	return true;
+}
+
+void FRRPDungeonGenerator::AddChangedTileNode(int nodeID)
+{
+	//The state before the first change is kept, the meshes only change when the state at the end of the update is different
+	if (TilesChangedByUpdate[nodeID])
+		return;
+
+	TilesChangedByUpdate[nodeID] = TileNodeChanged;
+	FTileNodeChange change{};
+	change.NodeID = nodeID;
+	change.OldType = TileNodeGrid.TileNodeTypes[nodeID];
+	change.WasInRoom = RoomOfTileNode[nodeID] != INDEX_NONE;
+	if (const FDoor* door = DoorTiles.Find(nodeID))
+	{
+		change.HadDoor = true;
+		change.OldDoorDirection = door->Direction;
+	}
+	ChangedTileNodes.Add(change);
+}
+
+void FRRPDungeonGenerator::GetKeptCorridors(const TArray<FRoomConnection>& connections, const TArray<int>& oldToNewRooms, const TArray<uint8>& isRoomChanged, TMap<uint64, int>& outKeptCorridors)
+{
+	//An old corridor is kept when its 2 rooms are still connected, both are unchanged and it does not cross the old or new area of a changed room.
+	//The path of every other corridor is cleared
+	TSet<uint64> connectionKeys{};
+	for (const FRoomConnection& connection : connections)
+	{
+		connectionKeys.Add(GetConnectionKey(connection.RoomA, connection.RoomB));
+	}
+
+	for (int corridorID = 0; corridorID < CorridorConnections.Num(); corridorID++)
+	{
+		const int roomA = oldToNewRooms[CorridorConnections[corridorID].RoomA];
+		const int roomB = oldToNewRooms[CorridorConnections[corridorID].RoomB];
+		const TArray<int>& path = CorridorPaths[corridorID];
+		bool isKept = roomA != INDEX_NONE && roomB != INDEX_NONE && !isRoomChanged[roomA] && !isRoomChanged[roomB];
+		isKept = isKept && !path.ContainsByPredicate([this](int nodeID) { return TilesChangedByUpdate[nodeID] != 0; });
+		const uint64 connectionKey = isKept ? GetConnectionKey(roomA, roomB) : 0;
+		if (isKept && connectionKeys.Contains(connectionKey) && !outKeptCorridors.Contains(connectionKey))
+		{
+			outKeptCorridors.Add(connectionKey, corridorID);
+			continue;
+		}
+
+		//The whole path, its room TileNodes got doors and connection costs from the corridor as well
+		for (int nodeID : path)
+		{
+			AddChangedTileNode(nodeID);
+		}
+	}
+}
+
+void FRRPDungeonGenerator::ClearChangedTileNodes(const TArray<FRRPRoom>& oldRooms, const TArray<int>& oldToNewRooms, const TArray<uint8>& isRoomChanged)
+{
+	//A changed TileNode loses its door and corridor, it only stays part of a room when that room is unchanged
+	for (const FTileNodeChange& change : ChangedTileNodes)
+	{
+		int& roomIndex = RoomOfTileNode[change.NodeID];
+		if (roomIndex != INDEX_NONE && (oldToNewRooms[roomIndex] == INDEX_NONE || isRoomChanged[oldToNewRooms[roomIndex]]))
+			roomIndex = INDEX_NONE;
+		TileNodeGrid.TileNodeTypes[change.NodeID] = roomIndex != INDEX_NONE ? ETileNodeType::ROOM : ETileNodeType::EMPTY;
+		DoorTiles.Remove(change.NodeID);
+	}
+
+	//Rooms after an added or removed premade room moved in ArrayOfRooms, their TileNodes get the new index.
+	//The new index is first stored below INDEX_NONE, so a TileNode is never taken for one of the room that had that index before
+	for (int pass = 0; pass < 2; pass++)
+	{
+		for (int oldRoomIndex = 0; oldRoomIndex < oldToNewRooms.Num(); oldRoomIndex++)
+		{
+			const int roomIndex = oldToNewRooms[oldRoomIndex];
+			if (roomIndex == INDEX_NONE || roomIndex == oldRoomIndex || isRoomChanged[roomIndex])
+				continue;
+
+			for (int nodeID : ArrayOfRooms[roomIndex].TileNodesOfRoom)
+			{
+				if (pass == 0 && RoomOfTileNode[nodeID] == oldRoomIndex)
+					RoomOfTileNode[nodeID] = INDEX_NONE - 1 - roomIndex;
+				else if (pass == 1 && RoomOfTileNode[nodeID] < INDEX_NONE)
+					RoomOfTileNode[nodeID] = INDEX_NONE - 1 - RoomOfTileNode[nodeID];
+			}
+		}
+	}
+
+	//An unchanged room that overlapped the old area of a changed or removed room gets back the TileNodes that were cleared
+	for (int oldRoomIndex = 0; oldRoomIndex < oldToNewRooms.Num(); oldRoomIndex++)
+	{
+		const int newRoomIndex = oldToNewRooms[oldRoomIndex];
+		if (newRoomIndex != INDEX_NONE && !isRoomChanged[newRoomIndex])
+			continue;
+
+		for (int roomIndex = 0; roomIndex < ArrayOfRooms.Num(); roomIndex++)
+		{
+			if (isRoomChanged[roomIndex] || !AreRoomsOverlapping(oldRooms[oldRoomIndex], ArrayOfRooms[roomIndex], 0.f))
+				continue;
+
+			for (int nodeID : ArrayOfRooms[roomIndex].TileNodesOfRoom)
+			{
+				if (TilesChangedByUpdate[nodeID] && RoomOfTileNode[nodeID] == INDEX_NONE)
+				{
+					RoomOfTileNode[nodeID] = roomIndex;
+					TileNodeGrid.TileNodeTypes[nodeID] = ETileNodeType::ROOM;
+				}
+			}
+		}
+	}
+
+	//The connection costs to and from a cleared TileNode only depend on the rooms now, the corridors set theirs again when they are committed
+	for (const FTileNodeChange& change : ChangedTileNodes)
+	{
+		for (int dir = 0; dir < FTileNodeGrid::NrOfDirections; dir++)
+		{
+			const int adjacentNodeID = TileNodeGrid.GetAdjacentNodeID(change.NodeID, dir);
+			if (adjacentNodeID == INDEX_NONE)
+				continue;
+
+			TileNodeGrid.GetConnectionCost(change.NodeID, dir) = RoomOfTileNode[adjacentNodeID] != INDEX_NONE ? Settings.RoomConnectionCost : Settings.EmptyTileConnectionCost;
+			TileNodeGrid.GetConnectionCost(adjacentNodeID, FTileNodeGrid::GetOppositeDirection(dir)) = RoomOfTileNode[change.NodeID] != INDEX_NONE ? Settings.RoomConnectionCost : Settings.EmptyTileConnectionCost;
+		}
+	}
+
+	{
+		SCOPE_CYCLE_COUNTER(STAT_RRPAttachTileNodesToRooms);
+		for (int roomIndex = 0; roomIndex < ArrayOfRooms.Num(); roomIndex++)
+		{
+			if (isRoomChanged[roomIndex])
+				AttachTileNodesToRoom(roomIndex);
+		}
+	}
+
+	//Only the clusters of the cleared TileNodes are calculated again before the next search
+	if (ClusterGraph.IsBuilt())
+	{
+		for (const FTileNodeChange& change : ChangedTileNodes)
+		{
+			ClusterGraph.MarkDirty(change.NodeID);
+		}
+	}
+}
+
+void FRRPDungeonGenerator::UpdateCorridors(const TArray<FRoomConnection>& connections, TMap<uint64, int>& keptCorridors)
+{
+	const TArray<FRoomConnection> oldCorridorConnections = MoveTemp(CorridorConnections);
+	TArray<TArray<int>> oldCorridorPaths = MoveTemp(CorridorPaths);
+	TMap<int, TArray<int>> oldCorridorTiles = MoveTemp(CorridorTiles);
+
+	//A kept corridor that does not cross a cleared TileNode stays on the grid as it is and only gets a new corridor ID.
+	//Its doors are found before any ID changes, the old IDs of different corridors can be the same as the new ones
+	TArray<int> oldCorridorIDs{};
+	oldCorridorIDs.Init(INDEX_NONE, connections.Num());
+	TArray<uint8> isCorridorOnGrid{};
+	isCorridorOnGrid.Init(0, connections.Num());
+	TArray<TPair<int, int>> doorCorridorIDs{};
+	int nrOfKeptCorridors = 0;
+	for (int i = 0; i < connections.Num(); i++)
+	{
+		int& oldCorridorID = oldCorridorIDs[i];
+		if (!keptCorridors.RemoveAndCopyValue(GetConnectionKey(connections[i].RoomA, connections[i].RoomB), oldCorridorID))
+			continue;
+
+		nrOfKeptCorridors++;
+		const TArray<int>& path = oldCorridorPaths[oldCorridorID];
+		if (path.ContainsByPredicate([this](int nodeID) { return TilesChangedByUpdate[nodeID] != 0; }))
+			continue;
+
+		isCorridorOnGrid[i] = 1;
+		for (int nodeID : path)
+		{
+			const FDoor* door = DoorTiles.Find(nodeID);
+			if (door != nullptr && door->CorridorID == oldCorridorID)
+				doorCorridorIDs.Add(TPair<int, int>(nodeID, CorridorConnections.Num()));
+		}
+		CorridorTiles.Add(CorridorConnections.Num(), MoveTemp(oldCorridorTiles.FindChecked(oldCorridorID)));
+		CorridorConnections.Add(connections[i]);
+		CorridorPaths.Add(MoveTemp(oldCorridorPaths[oldCorridorID]));
+		NrOfRoomConnections++;
+	}
+	for (auto& doorCorridorID : doorCorridorIDs)
+	{
+		DoorTiles[doorCorridorID.Key].CorridorID = doorCorridorID.Value;
+	}
+
+	//A kept corridor that crosses a cleared TileNode is committed again from its path, the other connections are searched
+	TArray<int> path{};
+	for (int i = 0; i < connections.Num() && !IsCancelled(); i++)
+	{
+		if (isCorridorOnGrid[i])
+			continue;
+
+		int startNodeID, endNodeID;
+		if (!GetConnectionNodeIDs(connections[i], startNodeID, endNodeID))
+			continue;
+
+		NrOfRoomConnections++;
+		if (oldCorridorIDs[i] != INDEX_NONE)
+			path = MoveTemp(oldCorridorPaths[oldCorridorIDs[i]]);
+		else
+		{
+			UpdateClusterGraph();
+			GetPath(PathSearch, startNodeID, endNodeID, path);
+		}
+
+		for (int nodeID : path)
+		{
+			AddChangedTileNode(nodeID);
+		}
+		CommitCorridor(connections[i], path);
+	}
+
+	Report.SetCounter(TEXT("KeptCorridors"), nrOfKeptCorridors);
+}
+
+void FRRPDungeonGenerator::UpdateDirtyTileNodes()
+{
+	//The meshes of a TileNode depend on its type, room and door and on those of the adjacent TileNodes,
+	//only the TileNodes changed by the update are compared with their state before it
+	for (const FTileNodeChange& change : ChangedTileNodes)
+	{
+		const FDoor* door = DoorTiles.Find(change.NodeID);
+		const bool isDoorChanged = change.HadDoor != (door != nullptr) || (door != nullptr && !door->Direction.Equals(change.OldDoorDirection));
+		const bool isRoomChanged = change.WasInRoom != (RoomOfTileNode[change.NodeID] != INDEX_NONE);
+		if (change.OldType == TileNodeGrid.TileNodeTypes[change.NodeID] && !isRoomChanged && !isDoorChanged)
+			continue;
+
+		for (int dir = -1; dir < FTileNodeGrid::NrOfDirections; dir++)
+		{
+			const int nodeID = dir < 0 ? change.NodeID : TileNodeGrid.GetAdjacentNodeID(change.NodeID, dir);
+			if (nodeID != INDEX_NONE && !(TilesChangedByUpdate[nodeID] & TileNodeDirty))
+			{
+				TilesChangedByUpdate[nodeID] |= TileNodeDirty;
+				DirtyTileNodes.Add(nodeID);
+			}
+		}
+	}
+
+	//The flags are cleared for the next update without going over the whole grid
+	for (const FTileNodeChange& change : ChangedTileNodes)
+	{
+		TilesChangedByUpdate[change.NodeID] = 0;
+	}
+	for (int nodeID : DirtyTileNodes)
+	{
+		TilesChangedByUpdate[nodeID] = 0;
+	}
+	ChangedTileNodes.Reset();
+}
+
+int FRRPDungeonGenerator::GetNrOfDifferentPathCosts()
+{
+	//The settings are only changed for these searches, the search functions read the algorithm and heuristic from them
+	const ERRPPathfindingAlgorithm pathfindingAlgorithm = Settings.PathfindingAlgorithm;
+	const ERRPHeuristicCost heuristicCost = Settings.HeuresticCostFunction;
+	Settings.HeuresticCostFunction = ERRPHeuristicCost::ADMISSIBLEMANHATTAN;
+
+	FTileNodeSearch search{};
+	TArray<int> path{};
+	int nrOfDifferentPathCosts = 0;
+	for (const FRoomConnection& connection : CorridorConnections)
+	{
+		int startNodeID, endNodeID;
+		if (!GetConnectionNodeIDs(connection, startNodeID, endNodeID))
+			continue;
+
+		double pathCosts[2]{};
+		const ERRPPathfindingAlgorithm algorithms[2] = { ERRPPathfindingAlgorithm::ASTAR, ERRPPathfindingAlgorithm::JUMPPOINTSEARCH };
+		for (int i = 0; i < 2; i++)
+		{
+			Settings.PathfindingAlgorithm = algorithms[i];
+			search.TotalPathCost = 0.0;
+			GetPathAStar(search, startNodeID, endNodeID, path);
+			pathCosts[i] = search.TotalPathCost;
+		}
+		nrOfDifferentPathCosts += !FMath::IsNearlyEqual(pathCosts[0], pathCosts[1], 0.01);
+	}
+
+	Settings.PathfindingAlgorithm = pathfindingAlgorithm;
+	Settings.HeuresticCostFunction = heuristicCost;
+	return nrOfDifferentPathCosts;
+}
+
+void FRRPDungeonGenerator::GetMeshInstancesOfTileNode(int nodeID, const TArray<ETileNodeType>& tilesTypesToIgnore, TArray<FTransform>& outFloorTransforms, TArray<FTransform>& outWallTransforms) const
+{
+	const FVector& tilePosition = TileNodeGrid.TilePositions[nodeID];
+	const ETileNodeType tileNodeType = TileNodeGrid.TileNodeTypes[nodeID];
+
+	//Floor mesh
+	FTransform floorTransform{};
+	floorTransform.SetLocation(tilePosition);
+	outFloorTransforms.Add(floorTransform);
+
+	//Wall meshes
+	FVector position{ 0,0,0 };
+	FRotator rot{};
+	FTransform wallTransform{};
+	int adjacentNodeID = INDEX_NONE;
+
+	for (auto& dir : AdjacentDirections)
+	{
+		//Get adjacent node
+		position = tilePosition + dir * Settings.RoomTileSize;
+		adjacentNodeID = GetNodeIDFromPosition(position);
+
+		//Calculate rotation and location, the wall looks from the direction to the center of the tile
+		rot = FRotationMatrix::MakeFromX(FVector::ZeroVector - dir).Rotator();
+		wallTransform.SetRotation(rot.Quaternion());
+		wallTransform.SetLocation(tilePosition + dir * (Settings.RoomTileSize / 2));
+
+		//Check if position it out of the grid -> spawn wall
+		if (!IsPositionInGrid(position)) {
+			outWallTransforms.Add(wallTransform);
+			continue;
+		}
+
+		//Check if adjacent tilenode type has to be blocked by a wall
+		const ETileNodeType adjacentNodeType = TileNodeGrid.TileNodeTypes[adjacentNodeID];
+		if (INDEX_NONE == tilesTypesToIgnore.Find(adjacentNodeType)) {
+
+			//Check if adjacent tile is a door tile and wall points towards door (blocking)
+			if (adjacentNodeType == ETileNodeType::DOOR) {
+				if (IsNodeTileAndDoorFacingSameDirection(nodeID, adjacentNodeID))
+					continue;
+			} //Check if node is Door and adjacent tile is corridor tile, check if door is facing opposite direction (blocking)
+			else if (tileNodeType == ETileNodeType::DOOR && adjacentNodeType == ETileNodeType::CORRIDOR) {
+				if (IsNodeTileAndDoorFacingSameDirection(adjacentNodeID, nodeID))
+					continue;
+			}
+
+			outWallTransforms.Add(wallTransform);
+		}
+
+	}
+}
+
+void FRRPDungeonGenerator::GenerateRooms()
+{
+	int currentNrOfRooms = Settings.PremadeRooms.Num();
+	for (size_t i = 0; i < currentNrOfRooms; i++)
+	{
+		ArrayOfRooms.Add(Settings.PremadeRooms[i]);
+	}
+
+	for (size_t i = currentNrOfRooms; i < Settings.NrOfRooms; i++)
+	{
+		//Every room has its own random stream
+		FDungeonRandomStream roomStream = RandomStream.Split(i);
+		FRRPRoom room{};
+		room.RoomID = i;
+		room.Width = roomStream.RandRange(Settings.MinRoomTiles, Settings.MaxRoomTiles) * Settings.RoomTileSize;
+		room.Height = roomStream.RandRange(Settings.MinRoomTiles, Settings.MaxRoomTiles) * Settings.RoomTileSize;
+		room.CentralPosition = GetRandomPointInCircle(roomStream);
+		ArrayOfRooms.Add(room);
+	}
+
+	SeperateRooms();
+}
+
+FVector FRRPDungeonGenerator::GetRandomPointInCircle(FDungeonRandomStream& stream) const
+{
+	//Draw the numbers one by one, the evaluation order inside an expression is not fixed
+	float angleX = stream.FRandRange(0.f, PI * 2.f);
+	float distanceX = stream.FRandRange(1.f, Settings.DungeonRadius);
+	float angleY = stream.FRandRange(0.f, PI * 2.f);
+	float distanceY = stream.FRandRange(1.f, Settings.DungeonRadius);
+
+	FVector randomPoint{};
+	randomPoint.X = Settings.DungeonCentralPosition.X + FMath::Cos(angleX) * distanceX;
+	randomPoint.Y = Settings.DungeonCentralPosition.X + FMath::Sin(angleY) * distanceY;
+	randomPoint.Z = Settings.DungeonCentralPosition.Z;
+
+	return randomPoint;
+}
+
+bool FRRPDungeonGenerator::SeperateRooms()
+{
+	HasOverlappingRooms = false;
+	NrOfSeperationIterations = 0;
+	bool areRoomsOverlapping = true;
+	TArray<int> candidateRooms{};
+
+	//Bucket the rooms in cells big enough that overlapping rooms are always in adjacent cells
+	float largestRoomSize = Settings.MaxRoomTiles * Settings.RoomTileSize;
+	for (auto& room : ArrayOfRooms)
+	{
+		largestRoomSize = FMath::Max(largestRoomSize, FMath::Max(room.Width, room.Height));
+	}
+	RoomSpatialHash.Init(largestRoomSize + Settings.RoomTileSize);
+	for (int i = 0; i < ArrayOfRooms.Num(); i++)
+	{
+		RoomSpatialHash.Add(i, ArrayOfRooms[i].CentralPosition);
+	}
+
+	while (areRoomsOverlapping && NrOfSeperationIterations < Settings.MaxSeperationIterations && !IsCancelled())
+	{
+		NrOfSeperationIterations++;
+		switch (Settings.SeperationMode)
+		{
+		case ERRPSeperationMode::SEQUENTIAL:
+			areRoomsOverlapping = SeperateRoomsSequential(candidateRooms);
+			break;
+		case ERRPSeperationMode::PARALLEL:
+			areRoomsOverlapping = SeperateRoomsParallel();
+			break;
+		default:
+			areRoomsOverlapping = false;
+			break;
+		}
+	}
+
+	HasOverlappingRooms = areRoomsOverlapping;
+	if (HasOverlappingRooms && !IsCancelled())
+		UE_LOG(LogDungeonGeneration, Warning, TEXT("Rooms are still overlapping after %d seperation iterations"), NrOfSeperationIterations);
+
+	return !HasOverlappingRooms;
+}
+
+bool FRRPDungeonGenerator::SeperateRoomsSequential(TArray<int>& candidateRooms)
+{
+	//Every room moves as soon as its push is known, the next rooms see the new position
+	bool areRoomsOverlapping = false;
+	for (int i = 0; i < ArrayOfRooms.Num(); i++)
+	{
+		bool isRoomOverlapping = false;
+		FVector push = GetSeperationPush(i, candidateRooms, isRoomOverlapping);
+		if (!isRoomOverlapping)
+			continue;
+
+		areRoomsOverlapping = true;
+		FVector oldPosition = ArrayOfRooms[i].CentralPosition;
+		ArrayOfRooms[i].CentralPosition += push;
+		RoomSpatialHash.Move(i, oldPosition, ArrayOfRooms[i].CentralPosition);
+	}
+	return areRoomsOverlapping;
+}
+
+bool FRRPDungeonGenerator::SeperateRoomsParallel()
+{
+	//All pushes are calculated from the positions of the previous pass and applied together afterwards,
+	//each push only depends on those positions so the result is the same for any number of threads
+	const int nrOfRooms = ArrayOfRooms.Num();
+	const int roomsPerBatch = 64;
+	const int nrOfBatches = FMath::DivideAndRoundUp(nrOfRooms, roomsPerBatch);
+	SeperationPushes.SetNumUninitialized(nrOfRooms);
+	RoomsOverlapping.SetNumUninitialized(nrOfRooms);
+
+	ParallelFor(nrOfBatches, [this, nrOfRooms, roomsPerBatch](int batchIndex)
+		{
+			TArray<int> candidateRooms{};
+			const int lastRoom = FMath::Min(nrOfRooms, (batchIndex + 1) * roomsPerBatch);
+			for (int i = batchIndex * roomsPerBatch; i < lastRoom; i++)
+			{
+				bool isRoomOverlapping = false;
+				SeperationPushes[i] = GetSeperationPush(i, candidateRooms, isRoomOverlapping);
+				RoomsOverlapping[i] = isRoomOverlapping;
+			}
+		});
+
+	bool areRoomsOverlapping = false;
+	for (int i = 0; i < nrOfRooms; i++)
+	{
+		if (!RoomsOverlapping[i])
+			continue;
+
+		areRoomsOverlapping = true;
+		FVector oldPosition = ArrayOfRooms[i].CentralPosition;
+		ArrayOfRooms[i].CentralPosition += SeperationPushes[i];
+		RoomSpatialHash.Move(i, oldPosition, ArrayOfRooms[i].CentralPosition);
+	}
+	return areRoomsOverlapping;
+}
+
+FVector FRRPDungeonGenerator::GetSeperationPush(int roomIndex, TArray<int>& candidateRooms, bool& isOverlapping) const
+{
+	FRRPRoom otherSquareRoom{};
+	FRRPRoom currentSquareRoom{};
+	const FRRPRoom& currentRoom = ArrayOfRooms[roomIndex];
+	float highestValue = FMath::Max(currentRoom.Width, currentRoom.Height);
+	currentSquareRoom.CentralPosition = currentRoom.CentralPosition;
+	currentSquareRoom.Width = highestValue;
+	currentSquareRoom.Height = highestValue;
+
+	//A: get all overlapping rooms from the nearby rooms and sum their direction to the current room
+	FVector averageVelocity{};
+	int nrOfOverlappingRooms = 0;
+	RoomSpatialHash.GetNearbyRooms(currentRoom.CentralPosition, candidateRooms);
+	for (int otherRoomIndex : candidateRooms)
+	{
+		const FRRPRoom& otherRoom = ArrayOfRooms[otherRoomIndex];
+		if (currentRoom.RoomID == otherRoom.RoomID)
+			continue;
+
+		//Change width and height to highest value -> square room
+		highestValue = FMath::Max(otherRoom.Width, otherRoom.Height);
+		otherSquareRoom.CentralPosition = otherRoom.CentralPosition;
+		otherSquareRoom.Width = highestValue;
+		otherSquareRoom.Height = highestValue;
+
+		if (AreRoomsOverlapping(currentSquareRoom, otherSquareRoom, Settings.RoomTileSize)) {
+			averageVelocity += currentRoom.CentralPosition - otherSquareRoom.CentralPosition;
+			nrOfOverlappingRooms++;
+		}
+	}
+
+	isOverlapping = nrOfOverlappingRooms > 0;
+	if (!isOverlapping)
+		return FVector::ZeroVector;
+
+	//B: Get average direction of all overlapping rooms to current room
+	averageVelocity /= nrOfOverlappingRooms;
+	averageVelocity.Normalize();
+	averageVelocity *= Settings.RoomTileSize;
+	return averageVelocity;
+}
+
+bool FRRPDungeonGenerator::AreRoomsOverlapping(const FRRPRoom& roomA, const FRRPRoom& roomB, float margin) const
+{
+	float roomAWidth = (roomA.Width + margin) / 2.f;
+	float roomAHeight = (roomA.Height + margin) / 2.f;
+	float roomBWidth = (roomB.Width + margin) / 2.f;
+	float roomBHeight = (roomB.Height + margin) / 2.f;
+
+
+	if (roomA.CentralPosition.X - roomAWidth < roomB.CentralPosition.X + roomBWidth
+		&& roomA.CentralPosition.X + roomAWidth > roomB.CentralPosition.X - roomBWidth
+		&& roomA.CentralPosition.Y + roomAHeight > roomB.CentralPosition.Y - roomBHeight
+		&& roomA.CentralPosition.Y - roomAHeight < roomB.CentralPosition.Y + roomBHeight)
+		return true;
+
+	return false;
+}
+
+void FRRPDungeonGenerator::ContructTileNodeGrid()
+{
+	//Create boundbox of rooms
+	float width{};
+	float height{};
+
+	for (auto& room : ArrayOfRooms)
+	{
+		width = room.Width / 2;
+		height = room.Height / 2;
+		TopOfGrid = FMath::Min(TopOfGrid, room.CentralPosition.Y - height);
+		BotOfGrid = FMath::Max(BotOfGrid, room.CentralPosition.Y + height);
+		RightOfGrid = FMath::Max(RightOfGrid, room.CentralPosition.X + width);
+		LeftOfGrid = FMath::Min(LeftOfGrid, room.CentralPosition.X - width);;
+	}
+	float gridPadding = Settings.RoomTileSize * 3;
+	TopOfGrid -= gridPadding;
+	BotOfGrid += gridPadding;
+	LeftOfGrid -= gridPadding;
+	RightOfGrid += gridPadding;
+
+	//Create a grid of TileNodes from the boundbox
+	NrOfGridCols = (RightOfGrid - LeftOfGrid) / Settings.RoomTileSize;
+	NrOfGridRows = (BotOfGrid - TopOfGrid) / Settings.RoomTileSize;
+	TileNodeGrid.Init(NrOfGridCols, NrOfGridRows, Settings.EmptyTileConnectionCost);
+	RoomOfTileNode.Init(INDEX_NONE, TileNodeGrid.Num());
+
+	int tileIndex = 0;
+	float x{}, y{};
+	for (int row = 0; row < NrOfGridRows; row++)
+	{
+		for (int col = 0; col < NrOfGridCols; col++)
+		{
+			x = LeftOfGrid + col * Settings.RoomTileSize - Settings.RoomTileSize / 2;
+			y = BotOfGrid - row * Settings.RoomTileSize + Settings.RoomTileSize / 2;
+			TileNodeGrid.TilePositions[tileIndex] = { x, y, 0 };
+			tileIndex++;
+		}
+	}
+}
+
+void FRRPDungeonGenerator::AttachTileNodesToRooms()
+{
+	for (int roomIndex = 0; roomIndex < ArrayOfRooms.Num(); roomIndex++) {
+		AttachTileNodesToRoom(roomIndex);
+	}
+}
+
+void FRRPDungeonGenerator::AttachTileNodesToRoom(int roomIndex)
+{
+	FRRPRoom& currentRoom = ArrayOfRooms[roomIndex];
+	GetTileNodesOfRoom(currentRoom, currentRoom.TileNodesOfRoom);
+	for (int nodeID : currentRoom.TileNodesOfRoom) {
+		TileNodeGrid.TileNodeTypes[nodeID] = ETileNodeType::ROOM;
+		RoomOfTileNode[nodeID] = roomIndex;
+
+		//Change connection cost of room tile to and from
+		for (int dir = 0; dir < FTileNodeGrid::NrOfDirections; dir++)
+		{
+			int adjacentNodeID = TileNodeGrid.GetAdjacentNodeID(nodeID, dir);
+			if (adjacentNodeID == INDEX_NONE)
+				continue;
+
+			//Change connection cost to adjacent node if also room tile
+			if (TileNodeGrid.TileNodeTypes[adjacentNodeID] == ETileNodeType::ROOM)
+				TileNodeGrid.GetConnectionCost(nodeID, dir) = Settings.RoomConnectionCost;
+
+			//Change connection back to original node
+			TileNodeGrid.GetConnectionCost(adjacentNodeID, FTileNodeGrid::GetOppositeDirection(dir)) = Settings.RoomConnectionCost;
+		}
+	}
+}
+
+void FRRPDungeonGenerator::GetTileNodesOfRoom(const FRRPRoom& room, TArray<int>& outNodeIDs) const
+{
+	float left{}, right{}, top{}, bot{};
+	FVector positionInRoom{ 0,0,0 };
+
+	//Calculate left, right, bot & top
+	left = room.CentralPosition.X - room.Width / 2.f;
+	right = room.CentralPosition.X + room.Width / 2.f;
+	top = room.CentralPosition.Y - room.Height / 2.f;
+	bot = room.CentralPosition.Y + room.Height / 2.f;
+
+	//Loop through tiles of room
+	for (float x = left; x < right; x += Settings.RoomTileSize)
+	{
+		for (float y = bot; y > top; y -= Settings.RoomTileSize) {
+			positionInRoom.X = x + Settings.RoomTileSize / 2.f;
+			positionInRoom.Y = y - Settings.RoomTileSize / 2.f;
+
+			//Find valid node by using position2node
+			int nodeID = GetNodeIDFromPosition(positionInRoom);
+			if (nodeID != INDEX_NONE)
+				outNodeIDs.Add(nodeID);
+		}
+	}
+}
+
+void FRRPDungeonGenerator::RandomRoomConnect()
+{
+	TArray<FRoomConnection> connections{};
+	GetRandomRoomConnections(connections);
+	ConnectRooms(connections);
+}
+
+void FRRPDungeonGenerator::MinimumSpanningTreeConnect()
+{
+	TArray<FRoomConnection> connections{};
+	GetMinimumSpanningTreeConnections(connections);
+	ConnectRooms(connections);
+}
+
+void FRRPDungeonGenerator::GetRoomConnections(TArray<FRoomConnection>& outConnections) const
+{
+	if (Settings.CorridorType == ERRPCorridorType::MINIMUMSPANNINGTREE)
+		GetMinimumSpanningTreeConnections(outConnections);
+	else
+		GetRandomRoomConnections(outConnections);
+}
+
+void FRRPDungeonGenerator::GetRandomRoomConnections(TArray<FRoomConnection>& outConnections) const
+{
+	//Connect every room to the next room in the array
+	for (int i = 0; i < ArrayOfRooms.Num() - 1; i++)
+	{
+		outConnections.Add({ i, i + 1, FVector::Dist2D(ArrayOfRooms[i].CentralPosition, ArrayOfRooms[i + 1].CentralPosition) });
+	}
+}
+
+void FRRPDungeonGenerator::GetMinimumSpanningTreeConnections(TArray<FRoomConnection>& outConnections) const
+{
+	//only rooms that are close to each other share a Delaunay edge, the MST of these edges connects every room with short corridors
+	TArray<FRoomConnection> connections{};
+	GetDelaunayConnections(connections);
+
+	TArray<FRoomConnection> otherConnections{};
+	GetMinimumSpanningTree(connections, outConnections, otherConnections);
+
+	//add a part of the other Delaunay edges back, so the dungeon gets some loops
+	FDungeonRandomStream connectionStream = RandomStream.Split(ConnectionStreamID);
+	const int nrOfExtraConnections = FMath::Min(FMath::CeilToInt(otherConnections.Num() * FMath::Clamp(Settings.ExtraConnectionFraction, 0.f, 1.f)), otherConnections.Num());
+	for (int i = 0; i < nrOfExtraConnections; i++)
+	{
+		const int pick = connectionStream.RandRange(i, otherConnections.Num() - 1);
+		otherConnections.Swap(i, pick);
+		outConnections.Add(otherConnections[i]);
+	}
+}
+
+void FRRPDungeonGenerator::GetDelaunayConnections(TArray<FRoomConnection>& outConnections) const
+{
+	//Bowyer-Watson triangulation of the central positions of the rooms
+	struct FTriangle
+	{
+		int Vertices[3];
+		FVector2D CircumCenter;
+		double CircumRadiusSquared;
+	};
+
+	const int nrOfRooms = ArrayOfRooms.Num();
+	if (nrOfRooms < 2)
+		return;
+
+	TArray<FVector2D> points{};
+	points.Reserve(nrOfRooms + 3);
+	FBox2D bounds{ ForceInit };
+	for (auto& room : ArrayOfRooms)
+	{
+		points.Add(FVector2D(room.CentralPosition.X, room.CentralPosition.Y));
+		bounds += points.Last();
+	}
+
+	//super triangle that contains all rooms, its vertices are removed at the end
+	const FVector2D center = bounds.GetCenter();
+	const float size = FMath::Max(FMath::Max(bounds.GetSize().X, bounds.GetSize().Y), 1.f) * 20.f;
+	points.Add(center + FVector2D(-size, -size));
+	points.Add(center + FVector2D(size, -size));
+	points.Add(center + FVector2D(0.f, size));
+
+	auto makeTriangle = [&points](int a, int b, int c)
+	{
+		FTriangle triangle{ { a, b, c }, FVector2D::ZeroVector, -1.0 };
+		const double ax = points[a].X, ay = points[a].Y;
+		const double bx = points[b].X, by = points[b].Y;
+		const double cx = points[c].X, cy = points[c].Y;
+		const double d = 2.0 * (ax * (by - cy) + bx * (cy - ay) + cx * (ay - by));
+		if (FMath::Abs(d) > SMALL_NUMBER)
+		{
+			const double ux = ((ax * ax + ay * ay) * (by - cy) + (bx * bx + by * by) * (cy - ay) + (cx * cx + cy * cy) * (ay - by)) / d;
+			const double uy = ((ax * ax + ay * ay) * (cx - bx) + (bx * bx + by * by) * (ax - cx) + (cx * cx + cy * cy) * (bx - ax)) / d;
+			triangle.CircumCenter = FVector2D(ux, uy);
+			triangle.CircumRadiusSquared = (ax - ux) * (ax - ux) + (ay - uy) * (ay - uy);
+		}
+		return triangle;
+	};
+
+	TArray<FTriangle> triangles{};
+	triangles.Add(makeTriangle(nrOfRooms, nrOfRooms + 1, nrOfRooms + 2));
+
+	TArray<FIntPoint> boundaryEdges{};
+	for (int pointIndex = 0; pointIndex < nrOfRooms; pointIndex++)
+	{
+		const FVector2D& point = points[pointIndex];
+
+		//remove the triangles whose circumcircle contains the point, the edges that are not shared between them form the hole
+		boundaryEdges.Reset();
+		for (int i = triangles.Num() - 1; i >= 0; i--)
+		{
+			const FTriangle& triangle = triangles[i];
+			const double dx = point.X - triangle.CircumCenter.X;
+			const double dy = point.Y - triangle.CircumCenter.Y;
+			if (triangle.CircumRadiusSquared >= 0.0 && dx * dx + dy * dy > triangle.CircumRadiusSquared)
+				continue;
+
+			for (int edge = 0; edge < 3; edge++)
+			{
+				const FIntPoint edgeVertices{ triangle.Vertices[edge], triangle.Vertices[(edge + 1) % 3] };
+				const int sharedEdgeIndex = boundaryEdges.IndexOfByPredicate([&edgeVertices](const FIntPoint& other)
+				{
+					return other.X == edgeVertices.Y && other.Y == edgeVertices.X;
+				});
+				if (sharedEdgeIndex != INDEX_NONE)
+					boundaryEdges.RemoveAtSwap(sharedEdgeIndex);
+				else
+					boundaryEdges.Add(edgeVertices);
+			}
+			triangles.RemoveAtSwap(i);
+		}
+
+		//fill the hole with triangles to the point
+		for (auto& edge : boundaryEdges)
+		{
+			triangles.Add(makeTriangle(edge.X, edge.Y, pointIndex));
+		}
+	}
+
+	//the edges of the triangles without a super triangle vertex, every edge once
+	TSet<uint64> addedEdges{};
+	for (auto& triangle : triangles)
+	{
+		for (int edge = 0; edge < 3; edge++)
+		{
+			const int roomA = FMath::Min(triangle.Vertices[edge], triangle.Vertices[(edge + 1) % 3]);
+			const int roomB = FMath::Max(triangle.Vertices[edge], triangle.Vertices[(edge + 1) % 3]);
+			if (roomB >= nrOfRooms)
+				continue;
+
+			bool isAlreadyAdded = false;
+			addedEdges.Add((uint64(roomA) << 32) | uint64(roomB), &isAlreadyAdded);
+			if (!isAlreadyAdded)
+				outConnections.Add({ roomA, roomB, FVector::Dist2D(ArrayOfRooms[roomA].CentralPosition, ArrayOfRooms[roomB].CentralPosition) });
+		}
+	}
+}
+
+void FRRPDungeonGenerator::GetMinimumSpanningTree(TArray<FRoomConnection>& connections, TArray<FRoomConnection>& outTreeConnections, TArray<FRoomConnection>& outOtherConnections) const
+{
+	//Kruskal, the shortest connections first and only if the rooms are not connected yet
+	const int nrOfRooms = ArrayOfRooms.Num();
+	TArray<int> parents{};
+	parents.SetNumUninitialized(nrOfRooms);
+	for (int i = 0; i < nrOfRooms; i++)
+	{
+		parents[i] = i;
+	}
+	auto findRoot = [&parents](int room)
+	{
+		while (parents[room] != room)
+		{
+			parents[room] = parents[parents[room]];
+			room = parents[room];
+		}
+		return room;
+	};
+
+	auto addConnections = [&](TArray<FRoomConnection>& connectionsToAdd, TArray<FRoomConnection>* outOther)
+	{
+		connectionsToAdd.StableSort([](const FRoomConnection& a, const FRoomConnection& b) { return a.Distance < b.Distance; });
+		for (auto& connection : connectionsToAdd)
+		{
+			const int rootA = findRoot(connection.RoomA);
+			const int rootB = findRoot(connection.RoomB);
+			if (rootA != rootB)
+			{
+				parents[rootA] = rootB;
+				outTreeConnections.Add(connection);
+			}
+			else if (outOther != nullptr)
+			{
+				outOther->Add(connection);
+			}
+		}
+	};
+	addConnections(connections, &outOtherConnections);
+
+	//the triangulation misses edges when all rooms are on 1 line, connect what is left with every other pair of rooms
+	if (outTreeConnections.Num() < nrOfRooms - 1)
+	{
+		TArray<FRoomConnection> allConnections{};
+		for (int roomA = 0; roomA < nrOfRooms; roomA++)
+		{
+			for (int roomB = roomA + 1; roomB < nrOfRooms; roomB++)
+			{
+				allConnections.Add({ roomA, roomB, FVector::Dist2D(ArrayOfRooms[roomA].CentralPosition, ArrayOfRooms[roomB].CentralPosition) });
+			}
+		}
+		addConnections(allConnections, nullptr);
+	}
+}
+
+void FRRPDungeonGenerator::ConnectRooms(const TArray<FRoomConnection>& connections)
+{
+	if (Settings.PathfindingMode == ERRPPathfindingMode::PARALLEL)
+		ConnectRoomsParallel(connections);
+	else
+		ConnectRoomsSequential(connections);
+}
+
+void FRRPDungeonGenerator::ConnectRoomsSequential(const TArray<FRoomConnection>& connections)
+{
+	//Every search sees the corridors of the searches before it
+	TArray<int> path{};
+	for (int i = 0; i < connections.Num() && !IsCancelled(); i++)
+	{
+		int startNodeID, endNodeID;
+		if (!GetConnectionNodeIDs(connections[i], startNodeID, endNodeID))
+			continue;
+
+		NrOfRoomConnections++;
+		UpdateClusterGraph();
+		GetPath(PathSearch, startNodeID, endNodeID, path);
+		CommitCorridor(connections[i], path);
+	}
+}
+
+void FRRPDungeonGenerator::ConnectRoomsParallel(const TArray<FRoomConnection>& connections)
+{
+	//The searches of a batch run at the same time on the TileNode grid as it was before the batch, nothing writes to the grid meanwhile.
+	//The paths are committed in the order of the connections, a path that crosses a TileNode changed by an earlier commit
+	//of the batch is searched again on the grid as it is now. The batches have a fixed size, so the result does not depend on the number of threads
+	const int connectionsPerTask = 4;
+	const int connectionsPerBatch = 64;
+	TArray<TArray<int>> paths{};
+	TArray<FTileNodeSearch> searches{};
+	TArray<int> changedNodeIDs{};
+	TilesChangedByCommit.Init(0, TileNodeGrid.Num());
+
+	for (int firstConnection = 0; firstConnection < connections.Num() && !IsCancelled(); firstConnection += connectionsPerBatch)
+	{
+		const int nrOfConnections = FMath::Min(connectionsPerBatch, connections.Num() - firstConnection);
+		const int nrOfTasks = FMath::DivideAndRoundUp(nrOfConnections, connectionsPerTask);
+		paths.SetNum(nrOfConnections);
+		if (searches.Num() < nrOfTasks)
+			searches.SetNum(nrOfTasks);
+		UpdateClusterGraph();
+
+		ParallelFor(nrOfTasks, [this, &connections, &paths, &searches, firstConnection, nrOfConnections, connectionsPerTask](int taskIndex)
+			{
+				const int lastConnection = FMath::Min(nrOfConnections, (taskIndex + 1) * connectionsPerTask);
+				for (int i = taskIndex * connectionsPerTask; i < lastConnection; i++)
+				{
+					paths[i].Reset();
+					int startNodeID, endNodeID;
+					if (!IsCancelled() && GetConnectionNodeIDs(connections[firstConnection + i], startNodeID, endNodeID))
+						GetPath(searches[taskIndex], startNodeID, endNodeID, paths[i]);
+				}
+			});
+
+		for (int i = 0; i < nrOfConnections && !IsCancelled(); i++)
+		{
+			int startNodeID, endNodeID;
+			if (!GetConnectionNodeIDs(connections[firstConnection + i], startNodeID, endNodeID))
+				continue;
+
+			//Search again if an earlier corridor of this batch changed a TileNode of the path
+			TArray<int>& path = paths[i];
+			const bool isConflicting = path.ContainsByPredicate([this](int nodeID) { return TilesChangedByCommit[nodeID] != 0; });
+			if (isConflicting)
+			{
+				NrOfPathConflicts++;
+				UpdateClusterGraph();
+				GetPath(PathSearch, startNodeID, endNodeID, path);
+			}
+
+			//Every TileNode of the path is marked, the commit can change its connection costs without changing its type
+			NrOfRoomConnections++;
+			CommitCorridor(connections[firstConnection + i], path);
+			for (int nodeID : path)
+			{
+				if (!TilesChangedByCommit[nodeID])
+				{
+					TilesChangedByCommit[nodeID] = 1;
+					changedNodeIDs.Add(nodeID);
+				}
+			}
+		}
+
+		//The next batch searches on the grid with all these corridors
+		for (int nodeID : changedNodeIDs)
+		{
+			TilesChangedByCommit[nodeID] = 0;
+		}
+		changedNodeIDs.Reset();
+	}
+
+	for (auto& search : searches)
+	{
+		PathSearch.NrOfPathSearches += search.NrOfPathSearches;
+		PathSearch.NrOfNodesExpanded += search.NrOfNodesExpanded;
+		PathSearch.OpenListPeakSize = FMath::Max(PathSearch.OpenListPeakSize, search.OpenListPeakSize);
+		PathSearch.NrOfSearchWindowFallbacks += search.NrOfSearchWindowFallbacks;
+		PathSearch.TotalPathCost += search.TotalPathCost;
+	}
+}
+
+uint64 FRRPDungeonGenerator::GetConnectionKey(int roomA, int roomB)
+{
+	return (uint64(FMath::Min(roomA, roomB)) << 32) | uint64(FMath::Max(roomA, roomB));
+}
+
+bool FRRPDungeonGenerator::GetConnectionNodeIDs(const FRoomConnection& connection, int& outStartNodeID, int& outEndNodeID) const
+{
+	outStartNodeID = GetNodeIDFromPosition(ArrayOfRooms[connection.RoomA].CentralPosition);
+	outEndNodeID = GetNodeIDFromPosition(ArrayOfRooms[connection.RoomB].CentralPosition);
+	return outStartNodeID != INDEX_NONE && outEndNodeID != INDEX_NONE;
+}
+
+void FRRPDungeonGenerator::UpdateClusterGraph()
+{
+	//Only the clusters crossed by the corridors since the last update are calculated again
+	if (ClusterGraph.IsBuilt())
+		NrOfClusterUpdates += ClusterGraph.UpdateDirtyClusters(TileNodeGrid, PathSearch.OpenList, PathSearch.StartClusterCosts);
+}
+
+void FRRPDungeonGenerator::CommitCorridor(const FRoomConnection& connection, TArray<int>& path)
+{
+	//The connection and path are kept, so an update of the rooms can commit the corridor again without searching
+	CorridorConnections.Add(connection);
+	CorridorPaths.Add(path);
+
+	//The empty TileNodes of the path become corridor before the doors are placed
+	for (int nodeID : path)
+	{
+		if (TileNodeGrid.TileNodeTypes[nodeID] == ETileNodeType::EMPTY)
+			TileNodeGrid.TileNodeTypes[nodeID] = ETileNodeType::CORRIDOR;
+	}
+
+	CreateCorridorFromPath(path);
+
+	//The corridor changed the connection costs of its TileNodes
+	if (ClusterGraph.IsBuilt())
+	{
+		for (int nodeID : path)
+		{
+			ClusterGraph.MarkDirty(nodeID);
+		}
+	}
+}
+
+void FRRPDungeonGenerator::CreateCorridorFromPath(TArray<int>& path)
+{
+	TArray<int> corridor{};
+	int prevNodeID = INDEX_NONE;
+	bool isDoorPlaced = false;
+	int corridorID = CorridorTiles.Num();
+
+	//Go through all the nodes of the path
+	int pathIndex{};
+	for (auto nodeID : path)
+	{
+		for (int dir = 0; dir < FTileNodeGrid::NrOfDirections; dir++)
+		{
+			int adjacentNodeID = TileNodeGrid.GetAdjacentNodeID(nodeID, dir);
+			if (adjacentNodeID != INDEX_NONE && TileNodeGrid.TileNodeTypes[adjacentNodeID] == ETileNodeType::CORRIDOR)
+				TileNodeGrid.GetConnectionCost(nodeID, dir) = Settings.CorridorConnectionCost;
+		}
+
+		switch (TileNodeGrid.TileNodeTypes[nodeID])
+		{
+		case ETileNodeType::EMPTY: //Empty tiles change to corridor tiles
+			//Check if start door is placed and if not change prev tile to a door tile
+			if (!isDoorPlaced) {
+				TileNodeGrid.TileNodeTypes[prevNodeID] = ETileNodeType::CORRIDOR;
+				isDoorPlaced = true;
+			}
+			break;
+		case ETileNodeType::ROOM:
+			//If door is placed and we enter another room, tile becomes a door and setdoor resets
+			if (isDoorPlaced) {
+				CreateDoorTile(nodeID, path[pathIndex - 1], corridorID);
+				isDoorPlaced = false;
+			}
+			break;
+		case ETileNodeType::CORRIDOR:
+			//Check if start door is placed and if not change prev tile to a door tile
+			if (!isDoorPlaced) {
+				CreateDoorTile(prevNodeID, path[pathIndex], corridorID);
+				isDoorPlaced = true;
+			}
+			break;
+		case ETileNodeType::DOOR:
+			//If door is already placed, this is end door and if not already placed first door
+			isDoorPlaced = !isDoorPlaced;
+			break;
+		default:
+			break;
+		}
+		prevNodeID = nodeID;
+		pathIndex++;
+
+		if (TileNodeGrid.TileNodeTypes[nodeID] != ETileNodeType::ROOM)
+			corridor.Add(nodeID);
+	}
+
+	CorridorTiles.Add(corridorID, corridor);
+}
+
+void FRRPDungeonGenerator::CreateDoorTile(int currentNodeID, int nextNodeID, int corridorID)
+{
+	FDoor door{};
+	TileNodeGrid.TileNodeTypes[currentNodeID] = ETileNodeType::DOOR;
+	door.CorridorID = corridorID;
+	door.TileID = currentNodeID;
+	FVector direction = TileNodeGrid.TilePositions[nextNodeID] - TileNodeGrid.TilePositions[currentNodeID];
+	float epsilon = 0.005f;
+	if (direction.X > epsilon || direction.X < -epsilon)
+		direction.X /= abs(direction.X);
+	if (direction.Y > epsilon || direction.Y < -epsilon)
+		direction.Y /= abs(direction.Y);
+	door.Direction = direction;
+	DoorTiles.Add(currentNodeID, door );
+}
+
+void FRRPDungeonGenerator::GetPath(FTileNodeSearch& search, int startNodeID, int endNodeID, TArray<int>& outPath) const
+{
+	if (ClusterGraph.IsBuilt())
+		GetPathHierarchical(search, startNodeID, endNodeID, outPath);
+	else
+		GetPathAStar(search, startNodeID, endNodeID, outPath);
+}
+
+void FRRPDungeonGenerator::GetPathAStar(FTileNodeSearch& search, int startNodeID, int endNodeID, TArray<int>& outPath) const
+{
+	outPath.Reset();
+
+	//Search the bounding box of the start and end node plus the margin, widen it when there is no path inside
+	const FIntRect wholeGrid{ 0, 0, TileNodeGrid.NrOfCols, TileNodeGrid.NrOfRows };
+	int margin = Settings.SearchWindowMargin;
+	search.Window = margin > 0 ? GetSearchWindow(startNodeID, endNodeID, margin) : wholeGrid;
+	int currentNodeID = startNodeID;
+	while (!SearchPathAStar(search, startNodeID, endNodeID, currentNodeID) && search.Window != wholeGrid)
+	{
+		search.NrOfSearchWindowFallbacks++;
+		margin *= 2;
+		search.Window = GetSearchWindow(startNodeID, endNodeID, margin);
+	}
+
+	AddReconstructedPath(search, startNodeID, currentNodeID, outPath);
+}
+
+void FRRPDungeonGenerator::GetPathHierarchical(FTileNodeSearch& search, int startNodeID, int endNodeID, TArray<int>& outPath) const
+{
+	outPath.Reset();
+	if (!SearchAbstractPath(search, startNodeID, endNodeID))
+	{
+		GetPathAStar(search, startNodeID, endNodeID, outPath);
+		return;
+	}
+
+	//Refine the waypoints from the end back to the start, so the TileNodes are added in the same order as GetPathAStar adds them.
+	//2 waypoints in the same cluster are connected by an A* search inside that cluster, 2 waypoints in different clusters are adjacent
+	for (int i = search.Waypoints.Num() - 1; i > 0; i--)
+	{
+		const int fromNodeID = search.Waypoints[i - 1];
+		const int toNodeID = search.Waypoints[i];
+		const int clusterIndex = ClusterGraph.GetClusterIndex(fromNodeID);
+		if (clusterIndex != ClusterGraph.GetClusterIndex(toNodeID))
+		{
+			for (int dir = 0; dir < FTileNodeGrid::NrOfDirections; dir++)
+			{
+				if (TileNodeGrid.GetAdjacentNodeID(fromNodeID, dir) == toNodeID)
+					search.TotalPathCost += TileNodeGrid.GetConnectionCost(fromNodeID, dir);
+			}
+			outPath.Add(toNodeID);
+			continue;
+		}
+
+		search.Window = ClusterGraph.GetClusterRect(clusterIndex);
+		int lastNodeID = fromNodeID;
+		SearchPathAStar(search, fromNodeID, toNodeID, lastNodeID);
+		AddReconstructedPath(search, fromNodeID, lastNodeID, outPath);
+	}
+}
+
+bool FRRPDungeonGenerator::SearchAbstractPath(FTileNodeSearch& search, int startNodeID, int endNodeID) const
+{
+	//The start and end TileNode are added to the abstract graph for this search only, after all entrances
+	const int nrOfEntrances = ClusterGraph.EntranceNodeIDs.Num();
+	const int startEntrance = nrOfEntrances;
+	const int endEntrance = nrOfEntrances + 1;
+	const int startClusterIndex = ClusterGraph.GetClusterIndex(startNodeID);
+	const int endClusterIndex = ClusterGraph.GetClusterIndex(endNodeID);
+	const FIntRect startRect = ClusterGraph.GetClusterRect(startClusterIndex);
+	const FIntRect endRect = ClusterGraph.GetClusterRect(endClusterIndex);
+	FTileNodeClusterGraph::GetCostsInRect(TileNodeGrid, startRect, startNodeID, false, search.OpenList, search.StartClusterCosts);
+	FTileNodeClusterGraph::GetCostsInRect(TileNodeGrid, endRect, endNodeID, true, search.OpenList, search.EndClusterCosts);
+
+	search.SearchID++;
+	search.OpenList.Reset(nrOfEntrances + 2);
+	if (search.EntranceRecords.Num() < nrOfEntrances + 2)
+		search.EntranceRecords.SetNum(nrOfEntrances + 2);
+
+	FTileNodeRecord& startRecord = GetEntranceRecord(search, startEntrance);
+	startRecord.EstimatedTotalCost = GetHeuristicCost(startNodeID, endNodeID);
+	startRecord.State = ETileNodeRecordState::OPEN;
+	search.OpenList.Push(startEntrance, startRecord.EstimatedTotalCost);
+
+	bool isPathFound = false;
+	while (!search.OpenList.IsEmpty())
+	{
+		const int currentEntrance = search.OpenList.Pop();
+		search.NrOfNodesExpanded++;
+		if (currentEntrance == endEntrance)
+		{
+			isPathFound = true;
+			break;
+		}
+
+		const float currentCostSoFar = GetEntranceRecord(search, currentEntrance).CostSoFar;
+		if (currentEntrance == startEntrance)
+		{
+			//From the start TileNode to the entrances of its cluster, or straight to the end TileNode in the same cluster
+			for (int entrance : ClusterGraph.ClusterEntrances[startClusterIndex])
+			{
+				const float cost = search.StartClusterCosts[FTileNodeClusterGraph::GetIndexInRect(TileNodeGrid, startRect, ClusterGraph.EntranceNodeIDs[entrance])];
+				if (cost < MAX_FLT)
+					UpdateEntranceRecord(search, currentEntrance, entrance, currentCostSoFar + cost, endNodeID);
+			}
+			if (startClusterIndex == endClusterIndex)
+			{
+				const float cost = search.StartClusterCosts[FTileNodeClusterGraph::GetIndexInRect(TileNodeGrid, startRect, endNodeID)];
+				if (cost < MAX_FLT)
+					UpdateEntranceRecord(search, currentEntrance, endEntrance, currentCostSoFar + cost, endNodeID);
+			}
+		}
+		else
+		{
+			const int currentNodeID = ClusterGraph.EntranceNodeIDs[currentEntrance];
+			for (const auto& edge : ClusterGraph.BorderEdges[currentEntrance])
+			{
+				UpdateEntranceRecord(search, currentEntrance, edge.ToEntrance, currentCostSoFar + TileNodeGrid.GetConnectionCost(currentNodeID, edge.Direction), endNodeID);
+			}
+			for (const auto& edge : ClusterGraph.ClusterEdges[currentEntrance])
+			{
+				UpdateEntranceRecord(search, currentEntrance, edge.ToEntrance, currentCostSoFar + edge.Cost, endNodeID);
+			}
+			if (ClusterGraph.GetClusterIndex(currentNodeID) == endClusterIndex)
+			{
+				const float cost = search.EndClusterCosts[FTileNodeClusterGraph::GetIndexInRect(TileNodeGrid, endRect, currentNodeID)];
+				if (cost < MAX_FLT)
+					UpdateEntranceRecord(search, currentEntrance, endEntrance, currentCostSoFar + cost, endNodeID);
+			}
+		}
+
+		GetEntranceRecord(search, currentEntrance).State = ETileNodeRecordState::CLOSED;
+		search.OpenListPeakSize = FMath::Max(search.OpenListPeakSize, search.OpenList.Num());
+	}
+
+	if (!isPathFound)
+		return false;
+
+	//The waypoints go from the start to the end TileNode
+	search.Waypoints.Reset();
+	for (int entrance = endEntrance; entrance != INDEX_NONE; entrance = GetEntranceRecord(search, entrance).FromNodeID)
+	{
+		search.Waypoints.Add(entrance == startEntrance ? startNodeID : entrance == endEntrance ? endNodeID : ClusterGraph.EntranceNodeIDs[entrance]);
+	}
+	Algo::Reverse(search.Waypoints);
+	return true;
+}
+
+void FRRPDungeonGenerator::UpdateEntranceRecord(FTileNodeSearch& search, int fromEntrance, int entrance, float costSoFar, int endNodeID) const
+{
+	//The records of the abstract graph use the entrance as NodeID, the end TileNode is the only one after the entrances that gets a connection
+	FTileNodeRecord& record = GetEntranceRecord(search, entrance);
+	const int nodeID = ClusterGraph.EntranceNodeIDs.IsValidIndex(entrance) ? ClusterGraph.EntranceNodeIDs[entrance] : endNodeID;
+	const float estimatedTotalCost = costSoFar + GetHeuristicCost(nodeID, endNodeID);
+	if (record.State != ETileNodeRecordState::UNVISITED && estimatedTotalCost >= record.EstimatedTotalCost)
+		return;
+
+	record.FromNodeID = fromEntrance;
+	record.CostSoFar = costSoFar;
+	record.EstimatedTotalCost = estimatedTotalCost;
+	//A closed record that gets a cheaper connection is opened again
+	if (record.State == ETileNodeRecordState::OPEN)
+		search.OpenList.Update(entrance, estimatedTotalCost);
+	else
+		search.OpenList.Push(entrance, estimatedTotalCost);
+	record.State = ETileNodeRecordState::OPEN;
+}
+
+FTileNodeRecord& FRRPDungeonGenerator::GetEntranceRecord(FTileNodeSearch& search, int entrance) const
+{
+	//Lazily reset records left behind by a previous search
+	FTileNodeRecord& record = search.EntranceRecords[entrance];
+	if (record.SearchID != search.SearchID) {
+		record = FTileNodeRecord();
+		record.SearchID = search.SearchID;
+	}
+	return record;
+}
+
+void FRRPDungeonGenerator::AddReconstructedPath(FTileNodeSearch& search, int startNodeID, int lastNodeID, TArray<int>& outPath) const
+{
+	//Reconstruct path from last connection to start node, the TileNodes between 2 jump points are added as well
+	int currentNodeID = lastNodeID;
+	while (currentNodeID != startNodeID && currentNodeID != -1)
+	{
+		const int fromNodeID = GetTileNodeRecord(search, currentNodeID).FromNodeID;
+		outPath.Add(currentNodeID);
+		if (fromNodeID != -1)
+		{
+			//A jump is a straight line along a row or column
+			const bool isSameRow = fromNodeID / TileNodeGrid.NrOfCols == currentNodeID / TileNodeGrid.NrOfCols;
+			const int step = (isSameRow ? 1 : TileNodeGrid.NrOfCols) * (fromNodeID > currentNodeID ? 1 : -1);
+			for (int nodeID = currentNodeID + step; nodeID != fromNodeID; nodeID += step)
+			{
+				outPath.Add(nodeID);
+			}
+		}
+		currentNodeID = fromNodeID;
+	}
+}
+
+bool FRRPDungeonGenerator::SearchPathAStar(FTileNodeSearch& search, int startNodeID, int endNodeID, int& outLastNodeID) const
+{
+	//Every search gets a new ID, records of older searches count as unvisited
+	search.SearchID++;
+	search.NrOfPathSearches++;
+	const int nrOfWindowNodes = search.Window.Area();
+	search.OpenList.Reset(nrOfWindowNodes);
+	if (search.TileNodeRecords.Num() < nrOfWindowNodes)
+		search.TileNodeRecords.SetNum(nrOfWindowNodes);
+
+	//Create a TileNodeRecord to start the loop
+	FTileNodeRecord& startRecord = GetTileNodeRecord(search, startNodeID);
+	startRecord.EstimatedTotalCost = GetHeuristicCost(startNodeID, endNodeID) / Settings.RoomTileSize;
+	startRecord.State = ETileNodeRecordState::OPEN;
+	search.OpenList.Push(GetSearchWindowIndex(search, startNodeID), startRecord.EstimatedTotalCost);
+
+	int currentNodeID = startNodeID;
+	bool isPathFound = false;
+	while (!search.OpenList.IsEmpty()) {
+		//Get NodeRecord with lowest cost from openList
+		const int currentWindowIndex = search.OpenList.Pop();
+		currentNodeID = (search.Window.Min.Y + currentWindowIndex / search.Window.Width()) * TileNodeGrid.NrOfCols + search.Window.Min.X + currentWindowIndex % search.Window.Width();
+		search.NrOfNodesExpanded++;
+
+		//Check if NodeRecord points to the goal
+		if (currentNodeID == endNodeID)
+		{
+			isPathFound = true;
+			break;
+		}
+
+		const FTileNodeRecord& currentRecord = GetTileNodeRecord(search, currentNodeID);
+		const float currentCostSoFar = currentRecord.CostSoFar;
+
+		//Jump Point Search: inside a uniform cost area only the jump points in the canonical directions are successors
+		if (Settings.PathfindingAlgorithm == ERRPPathfindingAlgorithm::JUMPPOINTSEARCH && IsJumpPointInterior(search, currentNodeID))
+		{
+			bool isJumpDirection[FTileNodeGrid::NrOfDirections] = { true, true, true, true };
+			if (currentRecord.FromNodeID != INDEX_NONE)
+				GetJumpDirections(search, currentRecord.FromNodeID, currentNodeID, isJumpDirection);
+
+			for (int dir = 0; dir < FTileNodeGrid::NrOfDirections; dir++)
+			{
+				int nrOfSteps = 0;
+				const int jumpPointNodeID = isJumpDirection[dir] ? Jump(search, currentNodeID, dir, endNodeID, nrOfSteps) : INDEX_NONE;
+				if (jumpPointNodeID != INDEX_NONE)
+					UpdateTileNodeRecord(search, currentNodeID, jumpPointNodeID, currentCostSoFar + nrOfSteps * Settings.EmptyTileConnectionCost, endNodeID);
+			}
+		}
+		else
+		{
+			//Loop through all the connections of the NodeRecord node
+			for (int dir = 0; dir < FTileNodeGrid::NrOfDirections; dir++)
+			{
+				int adjacentNodeID = TileNodeGrid.GetAdjacentNodeID(currentNodeID, dir);
+				if (adjacentNodeID == INDEX_NONE)
+					continue;
+
+				//The search does not leave the window
+				if (GetSearchWindowIndex(search, adjacentNodeID) == INDEX_NONE)
+					continue;
+
+				//Calculate the total cost so far (G-cost)
+				UpdateTileNodeRecord(search, currentNodeID, adjacentNodeID, currentCostSoFar + TileNodeGrid.GetConnectionCost(currentNodeID, dir), endNodeID);
+			}
+		}
+
+		//The NodeRecord is popped from the openList, close it
+		GetTileNodeRecord(search, currentNodeID).State = ETileNodeRecordState::CLOSED;
+		search.OpenListPeakSize = FMath::Max(search.OpenListPeakSize, search.OpenList.Num());
+	}
+
+	if (isPathFound)
+		search.TotalPathCost += GetTileNodeRecord(search, endNodeID).CostSoFar;
+	outLastNodeID = currentNodeID;
+	return isPathFound;
+}
+
+void FRRPDungeonGenerator::UpdateTileNodeRecord(FTileNodeSearch& search, int fromNodeID, int nodeID, float costSoFar, int endNodeID) const
+{
+	FTileNodeRecord& record = GetTileNodeRecord(search, nodeID);
+	float estimatedTotalCost = costSoFar + GetHeuristicCost(nodeID, endNodeID);
+
+	switch (record.State)
+	{
+	case ETileNodeRecordState::CLOSED: //Forget the closed record if the new connection is cheaper
+		//The record keeps its parent until it is opened again, see FTileNodeRecord for how this differs from the old search
+		if (estimatedTotalCost < record.EstimatedTotalCost)
+			record.State = ETileNodeRecordState::UNVISITED;
+		break;
+	case ETileNodeRecordState::OPEN: //Decrease the key of the open record if the new connection is cheaper
+		if (estimatedTotalCost < record.EstimatedTotalCost) {
+			record.FromNodeID = fromNodeID;
+			record.CostSoFar = costSoFar;
+			record.EstimatedTotalCost = estimatedTotalCost;
+			search.OpenList.Update(GetSearchWindowIndex(search, nodeID), estimatedTotalCost);
+		}
+		break;
+	case ETileNodeRecordState::UNVISITED:
+		record.FromNodeID = fromNodeID;
+		record.CostSoFar = costSoFar;
+		record.EstimatedTotalCost = estimatedTotalCost;
+		record.State = ETileNodeRecordState::OPEN;
+		search.OpenList.Push(GetSearchWindowIndex(search, nodeID), estimatedTotalCost);
+		break;
+	default:
+		break;
+	}
+}
+
+bool FRRPDungeonGenerator::IsUniformTileNode(int nodeID) const
+{
+	//An empty TileNode with the empty connection cost in every direction, moving from it always costs the same
+	if (TileNodeGrid.TileNodeTypes[nodeID] != ETileNodeType::EMPTY)
+		return false;
+
+	for (int dir = 0; dir < FTileNodeGrid::NrOfDirections; dir++)
+	{
+		if (TileNodeGrid.GetConnectionCost(nodeID, dir) != Settings.EmptyTileConnectionCost)
+			return false;
+	}
+	return true;
+}
+
+bool FRRPDungeonGenerator::IsJumpPointInterior(const FTileNodeSearch& search, int nodeID) const
+{
+	//A uniform TileNode next to a corridor, room or door is a boundary of the uniform area, it is expanded like A* does
+	if (!IsUniformTileNode(nodeID))
+		return false;
+
+	for (int dir = 0; dir < FTileNodeGrid::NrOfDirections; dir++)
+	{
+		const int adjacentNodeID = TileNodeGrid.GetAdjacentNodeID(nodeID, dir);
+		if (adjacentNodeID != INDEX_NONE && GetSearchWindowIndex(search, adjacentNodeID) != INDEX_NONE && !IsUniformTileNode(adjacentNodeID))
+			return false;
+	}
+	return true;
+}
+
+void FRRPDungeonGenerator::GetJumpDirections(const FTileNodeSearch& search, int fromNodeID, int nodeID, bool (&outIsJumpDirection)[FTileNodeGrid::NrOfDirections]) const
+{
+	//The canonical paths go vertical first and then horizontal, direction 0 and 2 are horizontal and 1 and 3 are vertical
+	const int fromCol = fromNodeID % TileNodeGrid.NrOfCols;
+	const int col = nodeID % TileNodeGrid.NrOfCols;
+	const bool isArrivingHorizontal = fromCol != col;
+	int arrivalDirection;
+	if (isArrivingHorizontal)
+		arrivalDirection = col > fromCol ? 0 : 2;
+	else
+		arrivalDirection = nodeID > fromNodeID ? 1 : 3;
+
+	for (int dir = 0; dir < FTileNodeGrid::NrOfDirections; dir++)
+	{
+		outIsJumpDirection[dir] = false;
+	}
+	outIsJumpDirection[arrivalDirection] = true;
+
+	if (!isArrivingHorizontal)
+	{
+		//after a vertical move, turning horizontal is natural
+		outIsJumpDirection[0] = true;
+		outIsJumpDirection[2] = true;
+		return;
+	}
+
+	//after a horizontal move, turning vertical is only needed when the TileNode behind that side is not uniform (forced neighbour)
+	const int behindNodeID = TileNodeGrid.GetAdjacentNodeID(nodeID, FTileNodeGrid::GetOppositeDirection(arrivalDirection));
+	for (int dir = 1; dir < FTileNodeGrid::NrOfDirections; dir += 2)
+	{
+		const int behindSideNodeID = behindNodeID != INDEX_NONE ? TileNodeGrid.GetAdjacentNodeID(behindNodeID, dir) : INDEX_NONE;
+		if (behindSideNodeID != INDEX_NONE && GetSearchWindowIndex(search, behindSideNodeID) != INDEX_NONE && !IsUniformTileNode(behindSideNodeID))
+			outIsJumpDirection[dir] = true;
+	}
+}
+
+int FRRPDungeonGenerator::Jump(const FTileNodeSearch& search, int nodeID, int direction, int endNodeID, int& outNrOfSteps) const
+{
+	//Step in a straight line through the uniform area until something interesting is found
+	outNrOfSteps = 0;
+	const bool isHorizontal = direction % 2 == 0;
+	while (true)
+	{
+		nodeID = TileNodeGrid.GetAdjacentNodeID(nodeID, direction);
+		if (nodeID == INDEX_NONE || GetSearchWindowIndex(search, nodeID) == INDEX_NONE)
+			return INDEX_NONE;
+		outNrOfSteps++;
+
+		//The goal and the boundary of the uniform area are jump points.
+		//Every TileNode passed by a jump is interior, so a forced neighbour can only be next to the first TileNode after a boundary
+		if (nodeID == endNodeID || !IsJumpPointInterior(search, nodeID))
+			return nodeID;
+
+		//A vertical jump stops where a horizontal jump finds something
+		if (!isHorizontal)
+		{
+			int nrOfHorizontalSteps = 0;
+			if (Jump(search, nodeID, 0, endNodeID, nrOfHorizontalSteps) != INDEX_NONE || Jump(search, nodeID, 2, endNodeID, nrOfHorizontalSteps) != INDEX_NONE)
+				return nodeID;
+		}
+	}
+}
+
+FIntRect FRRPDungeonGenerator::GetSearchWindow(int startNodeID, int endNodeID, int margin) const
+{
+	const int startCol = startNodeID % TileNodeGrid.NrOfCols;
+	const int startRow = startNodeID / TileNodeGrid.NrOfCols;
+	const int endCol = endNodeID % TileNodeGrid.NrOfCols;
+	const int endRow = endNodeID / TileNodeGrid.NrOfCols;
+
+	FIntRect window{};
+	window.Min.X = FMath::Max(FMath::Min(startCol, endCol) - margin, 0);
+	window.Min.Y = FMath::Max(FMath::Min(startRow, endRow) - margin, 0);
+	window.Max.X = FMath::Min(FMath::Max(startCol, endCol) + margin + 1, TileNodeGrid.NrOfCols);
+	window.Max.Y = FMath::Min(FMath::Max(startRow, endRow) + margin + 1, TileNodeGrid.NrOfRows);
+	return window;
+}
+
+int FRRPDungeonGenerator::GetSearchWindowIndex(const FTileNodeSearch& search, int nodeID) const
+{
+	const int col = nodeID % TileNodeGrid.NrOfCols - search.Window.Min.X;
+	const int row = nodeID / TileNodeGrid.NrOfCols - search.Window.Min.Y;
+	if (col < 0 || row < 0 || col >= search.Window.Width() || row >= search.Window.Height())
+		return INDEX_NONE;
+	return row * search.Window.Width() + col;
+}
+
+FTileNodeRecord& FRRPDungeonGenerator::GetTileNodeRecord(FTileNodeSearch& search, int nodeID) const
+{
+	//Lazily reset records left behind by a previous search
+	FTileNodeRecord& record = search.TileNodeRecords[GetSearchWindowIndex(search, nodeID)];
+	if (record.SearchID != search.SearchID) {
+		record = FTileNodeRecord();
+		record.SearchID = search.SearchID;
+	}
+	return record;
+}
+
+float FRRPDungeonGenerator::GetHeuristicCost(int startNodeID, int endNodeID) const {
+
+	float heuristicCost{};
+	FVector toDestination = TileNodeGrid.TilePositions[endNodeID] - TileNodeGrid.TilePositions[startNodeID];
+	float x = abs(toDestination.X);
+	float y = abs(toDestination.Y);
+	float f{};
+
+	switch (Settings.HeuresticCostFunction)
+	{
+	case ERRPHeuristicCost::MANHATTAN:
+		return float(x + y);
+		break;
+	case ERRPHeuristicCost::EUCLIDEAN:
+		return float(FMath::Square(x * x + y * y));
+		break;
+	case ERRPHeuristicCost::SQRTEUCLIDEAN:
+		return float(x * x + y * y);
+		break;
+	case ERRPHeuristicCost::OCTILE:
+		f = 0.414213562373095048801f; // == sqrt(2) - 1;
+		return float((x < y) ? f * x + y : f * y + x);
+		break;
+	case ERRPHeuristicCost::CHEBYSHEV:
+		return FMath::Max(x, y);
+		break;
+	case ERRPHeuristicCost::ADMISSIBLEMANHATTAN:
+		return float((x + y) / Settings.RoomTileSize * FMath::Min3(Settings.EmptyTileConnectionCost, Settings.CorridorConnectionCost, Settings.RoomConnectionCost));
+		break;
+	default:
+		return 0.f;
+		break;
+	}
+}
+
+bool FRRPDungeonGenerator::IsPositionInGrid(const FVector& pos) const
+{
+	if (LeftOfGrid <= pos.X && pos.X <= RightOfGrid
+		&& TopOfGrid <= pos.Y && pos.Y <= BotOfGrid)
+		return true;
+	return false;
+}
+
+bool FRRPDungeonGenerator::IsNodeTileAndDoorFacingSameDirection(int nodeID, int doorNodeID) const
+{
+	FVector directionToDoor{};
+	if (auto door = DoorTiles.Find(doorNodeID))
+	{
+		directionToDoor = TileNodeGrid.TilePositions[nodeID] - TileNodeGrid.TilePositions[doorNodeID];
+		directionToDoor.Normalize();
+		bool isDoorFacingSameDirection = int(directionToDoor.X) == int(door->Direction.X)
+			&& int(directionToDoor.Y) == int(door->Direction.Y);
+		if (isDoorFacingSameDirection)
+			return true;
+	}
+	return false;
+}
+
+int FRRPDungeonGenerator::GetNodeIDFromPosition(const FVector& pos) const
+{
+	float x = pos.X;
+	float y = pos.Y;
+
+	if (LeftOfGrid < 0.f)
+		x += abs(LeftOfGrid);
+	if (BotOfGrid > 0.f)
+		y -= abs(BotOfGrid);
+	if (y < 0.f) //The y is inverted, -y is top and +y is bot
+		y *= -1.f;
+
+	int c = int(x / Settings.RoomTileSize) + 1;
+	c = FMath::Clamp(c, 0, NrOfGridCols - 1);
+	int r = int(y / Settings.RoomTileSize) + 1;
+	r = FMath::Clamp(r, 0, NrOfGridRows - 1);
+	int idx = r * NrOfGridCols + c;
+
+	if (TileNodeGrid.IsValidNodeID(idx))
+		return idx;
+
+	return INDEX_NONE;
+}
+
+void FTileNodeGrid::Init(int nrOfCols, int nrOfRows, float connectionCost)
+{
+	NrOfCols = FMath::Max(nrOfCols, 0);
+	NrOfRows = FMath::Max(nrOfRows, 0);
+	const int nrOfNodes = NrOfCols * NrOfRows;
+	TileNodeTypes.Init(ETileNodeType::EMPTY, nrOfNodes);
+	TilePositions.SetNumUninitialized(nrOfNodes);
+	ConnectionCosts.Init(connectionCost, nrOfNodes * NrOfDirections);
+}
+
+void FTileNodeGrid::Empty()
+{
+	TileNodeTypes.Empty();
+	TilePositions.Empty();
+	ConnectionCosts.Empty();
+	NrOfCols = 0;
+	NrOfRows = 0;
+}
+
+int FTileNodeGrid::GetAdjacentNodeID(int nodeID, int direction) const
+{
+	const int col = nodeID % NrOfCols;
+	const int row = nodeID / NrOfCols;
+	switch (direction)
+	{
+	case 0:
+		return col + 1 < NrOfCols ? nodeID + 1 : INDEX_NONE;
+	case 1:
+		return row + 1 < NrOfRows ? nodeID + NrOfCols : INDEX_NONE;
+	case 2:
+		return col > 0 ? nodeID - 1 : INDEX_NONE;
+	case 3:
+		return row > 0 ? nodeID - NrOfCols : INDEX_NONE;
+	default:
+		return INDEX_NONE;
+	}
+}
+
+void FTileNodeOpenList::Reset(int nrOfNodes)
+{
+	for (auto& entry : Heap)
+	{
+		HeapIndices[entry.NodeID] = INDEX_NONE;
+	}
+	Heap.Reset();
+
+	//Only grows, the indices that were used are set back to INDEX_NONE above
+	const int oldNrOfNodes = HeapIndices.Num();
+	if (oldNrOfNodes < nrOfNodes)
+	{
+		HeapIndices.SetNumUninitialized(nrOfNodes);
+		for (int i = oldNrOfNodes; i < nrOfNodes; i++)
+		{
+			HeapIndices[i] = INDEX_NONE;
+		}
+	}
+	NextOrder = 0;
+}
+
+void FTileNodeOpenList::Push(int nodeID, float estimatedTotalCost)
+{
+	int heapIndex = Heap.Add({ nodeID, estimatedTotalCost, NextOrder++ });
+	HeapIndices[nodeID] = heapIndex;
+	SiftUp(heapIndex);
+}
+
+void FTileNodeOpenList::Update(int nodeID, float estimatedTotalCost)
+{
+	//An updated record moves behind the records with the same cost, like a remove + add would
+	int heapIndex = HeapIndices[nodeID];
+	Heap[heapIndex].EstimatedTotalCost = estimatedTotalCost;
+	Heap[heapIndex].Order = NextOrder++;
+	SiftUp(heapIndex);
+	SiftDown(HeapIndices[nodeID]);
+}
+
+int FTileNodeOpenList::Pop()
+{
+	int nodeID = Heap[0].NodeID;
+	Swap(0, Heap.Num() - 1);
+	Heap.Pop(false);
+	HeapIndices[nodeID] = INDEX_NONE;
+	if (Heap.Num() > 0)
+		SiftDown(0);
+	return nodeID;
+}
+
+bool FTileNodeOpenList::IsLess(const FEntry& a, const FEntry& b) const
+{
+	if (a.EstimatedTotalCost != b.EstimatedTotalCost)
+		return a.EstimatedTotalCost < b.EstimatedTotalCost;
+	return a.Order < b.Order;
+}
+
+void FTileNodeOpenList::SiftUp(int heapIndex)
+{
+	while (heapIndex > 0)
+	{
+		int parentIndex = (heapIndex - 1) / 2;
+		if (!IsLess(Heap[heapIndex], Heap[parentIndex]))
+			break;
+		Swap(heapIndex, parentIndex);
+		heapIndex = parentIndex;
+	}
+}
+
+void FTileNodeOpenList::SiftDown(int heapIndex)
+{
+	while (true)
+	{
+		int smallestIndex = heapIndex;
+		int leftIndex = 2 * heapIndex + 1;
+		int rightIndex = 2 * heapIndex + 2;
+		if (leftIndex < Heap.Num() && IsLess(Heap[leftIndex], Heap[smallestIndex]))
+			smallestIndex = leftIndex;
+		if (rightIndex < Heap.Num() && IsLess(Heap[rightIndex], Heap[smallestIndex]))
+			smallestIndex = rightIndex;
+		if (smallestIndex == heapIndex)
+			break;
+		Swap(heapIndex, smallestIndex);
+		heapIndex = smallestIndex;
+	}
+}
+
+void FTileNodeOpenList::Swap(int heapIndexA, int heapIndexB)
+{
+	Heap.Swap(heapIndexA, heapIndexB);
+	HeapIndices[Heap[heapIndexA].NodeID] = heapIndexA;
+	HeapIndices[Heap[heapIndexB].NodeID] = heapIndexB;
+}
+
+void FTileNodeClusterGraph::Build(const FTileNodeGrid& grid, int clusterSize, FTileNodeOpenList& openList, TArray<float>& costs)
+{
+	Empty();
+	ClusterSize = FMath::Max(clusterSize, 2);
+	NrOfGridCols = grid.NrOfCols;
+	NrOfGridRows = grid.NrOfRows;
+	NrOfClusterCols = FMath::DivideAndRoundUp(NrOfGridCols, ClusterSize);
+	NrOfClusterRows = FMath::DivideAndRoundUp(NrOfGridRows, ClusterSize);
+	const int nrOfClusters = NrOfClusterCols * NrOfClusterRows;
+	ClusterEntrances.SetNum(nrOfClusters);
+	DirtyClusters.Init(1, nrOfClusters);
+	DirtyClusterIndices.Reserve(nrOfClusters);
+
+	//Every cluster adds the entrances on its border with the next column and the next row of clusters
+	for (int clusterIndex = 0; clusterIndex < nrOfClusters; clusterIndex++)
+	{
+		const FIntRect rect = GetClusterRect(clusterIndex);
+		if (rect.Max.X < NrOfGridCols)
+			AddBorderEntrances(grid, rect.Min.Y * NrOfGridCols + rect.Max.X - 1, NrOfGridCols, rect.Height(), 0);
+		if (rect.Max.Y < NrOfGridRows)
+			AddBorderEntrances(grid, (rect.Max.Y - 1) * NrOfGridCols + rect.Min.X, 1, rect.Width(), 1);
+		DirtyClusterIndices.Add(clusterIndex);
+	}
+
+	UpdateDirtyClusters(grid, openList, costs);
+}
+
+void FTileNodeClusterGraph::Empty()
+{
+	ClusterSize = 0;
+	NrOfClusterCols = 0;
+	NrOfClusterRows = 0;
+	NrOfGridCols = 0;
+	NrOfGridRows = 0;
+	EntranceNodeIDs.Reset();
+	BorderEdges.Reset();
+	ClusterEdges.Reset();
+	ClusterEntrances.Reset();
+	NodeEntrances.Reset();
+	DirtyClusters.Reset();
+	DirtyClusterIndices.Reset();
+}
+
+int FTileNodeClusterGraph::GetClusterIndex(int nodeID) const
+{
+	const int col = nodeID % NrOfGridCols;
+	const int row = nodeID / NrOfGridCols;
+	return (row / ClusterSize) * NrOfClusterCols + col / ClusterSize;
+}
+
+FIntRect FTileNodeClusterGraph::GetClusterRect(int clusterIndex) const
+{
+	//The clusters of the last column and row are smaller when the grid is not a multiple of the cluster size
+	const int minCol = (clusterIndex % NrOfClusterCols) * ClusterSize;
+	const int minRow = (clusterIndex / NrOfClusterCols) * ClusterSize;
+	return FIntRect(minCol, minRow, FMath::Min(minCol + ClusterSize, NrOfGridCols), FMath::Min(minRow + ClusterSize, NrOfGridRows));
+}
+
+void FTileNodeClusterGraph::MarkDirty(int nodeID)
+{
+	const int clusterIndex = GetClusterIndex(nodeID);
+	if (!DirtyClusters[clusterIndex])
+	{
+		DirtyClusters[clusterIndex] = 1;
+		DirtyClusterIndices.Add(clusterIndex);
+	}
+}
+
+int FTileNodeClusterGraph::UpdateDirtyClusters(const FTileNodeGrid& grid, FTileNodeOpenList& openList, TArray<float>& costs)
+{
+	const int nrOfClusters = DirtyClusterIndices.Num();
+	for (int clusterIndex : DirtyClusterIndices)
+	{
+		UpdateCluster(grid, clusterIndex, openList, costs);
+		DirtyClusters[clusterIndex] = 0;
+	}
+	DirtyClusterIndices.Reset();
+	return nrOfClusters;
+}
+
+void FTileNodeClusterGraph::UpdateCluster(const FTileNodeGrid& grid, int clusterIndex, FTileNodeOpenList& openList, TArray<float>& costs)
+{
+	//1 search per entrance gives the costs to all other entrances of the cluster
+	const FIntRect rect = GetClusterRect(clusterIndex);
+	const TArray<int>& entrances = ClusterEntrances[clusterIndex];
+	for (int entrance : entrances)
+	{
+		ClusterEdges[entrance].Reset();
+		GetCostsInRect(grid, rect, EntranceNodeIDs[entrance], false, openList, costs);
+		for (int otherEntrance : entrances)
+		{
+			const float cost = costs[GetIndexInRect(grid, rect, EntranceNodeIDs[otherEntrance])];
+			if (otherEntrance != entrance && cost < MAX_FLT)
+				ClusterEdges[entrance].Add({ otherEntrance, cost });
+		}
+	}
+}
+
+void FTileNodeClusterGraph::AddBorderEntrances(const FTileNodeGrid& grid, int firstNodeID, int step, int length, int direction)
+{
+	//The border is split in spans that are empty on both sides and spans that are not. A long empty span gets an entrance at both ends,
+	//every other span 1 in the middle, so the route can cross a room or corridor but prefers the empty tiles
+	auto isEmptyOnBothSides = [&grid, firstNodeID, step, direction](int i)
+	{
+		const int nodeID = firstNodeID + i * step;
+		return grid.TileNodeTypes[nodeID] == ETileNodeType::EMPTY && grid.TileNodeTypes[grid.GetAdjacentNodeID(nodeID, direction)] == ETileNodeType::EMPTY;
+	};
+	auto addEntrances = [this, &grid, firstNodeID, step, direction](int i)
+	{
+		const int nodeID = firstNodeID + i * step;
+		const int adjacentNodeID = grid.GetAdjacentNodeID(nodeID, direction);
+		const int entrance = GetOrAddEntrance(nodeID);
+		const int adjacentEntrance = GetOrAddEntrance(adjacentNodeID);
+		BorderEdges[entrance].Add({ adjacentEntrance, direction });
+		BorderEdges[adjacentEntrance].Add({ entrance, FTileNodeGrid::GetOppositeDirection(direction) });
+	};
+
+	int spanStart = 0;
+	for (int i = 1; i <= length; i++)
+	{
+		if (i < length && isEmptyOnBothSides(i) == isEmptyOnBothSides(spanStart))
+			continue;
+
+		const int spanLength = i - spanStart;
+		if (isEmptyOnBothSides(spanStart) && spanLength >= MinSplitEntranceLength)
+		{
+			addEntrances(spanStart);
+			addEntrances(i - 1);
+		}
+		else
+			addEntrances(spanStart + spanLength / 2);
+		spanStart = i;
+	}
+}
+
+int FTileNodeClusterGraph::GetOrAddEntrance(int nodeID)
+{
+	if (const int* entrance = NodeEntrances.Find(nodeID))
+		return *entrance;
+
+	const int entrance = EntranceNodeIDs.Add(nodeID);
+	BorderEdges.AddDefaulted();
+	ClusterEdges.AddDefaulted();
+	ClusterEntrances[GetClusterIndex(nodeID)].Add(entrance);
+	NodeEntrances.Add(nodeID, entrance);
+	return entrance;
+}
+
+void FTileNodeClusterGraph::GetCostsInRect(const FTileNodeGrid& grid, const FIntRect& rect, int nodeID, bool isReversed, FTileNodeOpenList& openList, TArray<float>& outCosts)
+{
+	const int nrOfRectNodes = rect.Area();
+	outCosts.Init(MAX_FLT, nrOfRectNodes);
+	openList.Reset(nrOfRectNodes);
+	const int startIndex = GetIndexInRect(grid, rect, nodeID);
+	outCosts[startIndex] = 0.f;
+	openList.Push(startIndex, 0.f);
+
+	while (!openList.IsEmpty())
+	{
+		const int currentIndex = openList.Pop();
+		const int currentNodeID = (rect.Min.Y + currentIndex / rect.Width()) * grid.NrOfCols + rect.Min.X + currentIndex % rect.Width();
+		for (int dir = 0; dir < FTileNodeGrid::NrOfDirections; dir++)
+		{
+			const int adjacentNodeID = grid.GetAdjacentNodeID(currentNodeID, dir);
+			const int adjacentIndex = adjacentNodeID != INDEX_NONE ? GetIndexInRect(grid, rect, adjacentNodeID) : INDEX_NONE;
+			if (adjacentIndex == INDEX_NONE)
+				continue;
+
+			//The reversed search follows the connections backwards, to get the cost from every TileNode to the start
+			const float connectionCost = isReversed ? grid.GetConnectionCost(adjacentNodeID, FTileNodeGrid::GetOppositeDirection(dir)) : grid.GetConnectionCost(currentNodeID, dir);
+			const float cost = outCosts[currentIndex] + connectionCost;
+			if (cost >= outCosts[adjacentIndex])
+				continue;
+
+			//The costs are never negative, so a TileNode that already has a cost is still on the open list
+			if (outCosts[adjacentIndex] == MAX_FLT)
+				openList.Push(adjacentIndex, cost);
+			else
+				openList.Update(adjacentIndex, cost);
+			outCosts[adjacentIndex] = cost;
+		}
+	}
+}
+
+int FTileNodeClusterGraph::GetIndexInRect(const FTileNodeGrid& grid, const FIntRect& rect, int nodeID)
+{
+	const int col = nodeID % grid.NrOfCols - rect.Min.X;
+	const int row = nodeID / grid.NrOfCols - rect.Min.Y;
+	if (col < 0 || row < 0 || col >= rect.Width() || row >= rect.Height())
+		return INDEX_NONE;
+	return row * rect.Width() + col;
+}
+
+void FRoomSpatialHash::Init(float cellSize)
+{
+	CellSize = FMath::Max(cellSize, 1.f);
+	Cells.Reset();
+}
+
+FIntPoint FRoomSpatialHash::GetCell(const FVector& pos) const
+{
+	return { FMath::FloorToInt(pos.X / CellSize), FMath::FloorToInt(pos.Y / CellSize) };
+}
+
+void FRoomSpatialHash::Add(int roomIndex, const FVector& pos)
+{
+	Cells.FindOrAdd(GetCell(pos)).Add(roomIndex);
+}
+
+void FRoomSpatialHash::Move(int roomIndex, const FVector& oldPos, const FVector& newPos)
+{
+	FIntPoint oldCell = GetCell(oldPos);
+	FIntPoint newCell = GetCell(newPos);
+	if (oldCell == newCell)
+		return;
+
+	if (auto roomsInCell = Cells.Find(oldCell))
+		roomsInCell->RemoveSingleSwap(roomIndex, false);
+	Cells.FindOrAdd(newCell).Add(roomIndex);
+}
+
+void FRoomSpatialHash::GetNearbyRooms(const FVector& pos, TArray<int>& outRoomIndices) const
+{
+	outRoomIndices.Reset();
+	FIntPoint cell = GetCell(pos);
+	for (int y = cell.Y - 1; y <= cell.Y + 1; y++)
+	{
+		for (int x = cell.X - 1; x <= cell.X + 1; x++)
+		{
+			if (auto roomsInCell = Cells.Find({ x, y }))
+				outRoomIndices.Append(*roomsInCell);
+		}
+	}
+
+	//Keep the order of the room array, so the result does not depend on the cell layout
+	outRoomIndices.Sort();
+}
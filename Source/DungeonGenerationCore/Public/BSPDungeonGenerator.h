@@ -0,0 +1,240 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "DungeonRandomStream.h"
+#include "DungeonGenerationReport.h"
+#include "DungeonMeshInstances.h"
+#include "HAL/ThreadSafeBool.h"
+
+enum class ESeperation : uint8 {
+	VERTICAL = 0,
+	HORIZONTAL = 1,
+};
+
+enum class ETileType : uint8 {
+	EMPTY = 0,
+	ROOM = 1,
+	CORRIDOR = 2,
+};
+
+enum class EDungeonObjectType : uint8 {
+	FLOOR = 0,
+	WALL = 1,
+	CEILING = 2,
+	PILLAR = 3,
+	TORCH = 4,
+};
+
+enum class EDungeonObjectAlign : uint8 {
+	LEFT = 0,
+	RIGHT = 1,
+	TOP = 2,
+	BOTTOM = 3,
+	CENTER = 4,
+};
+
+struct FDungeonObject
+{
+	EDungeonObjectType objectType;
+	FVector rotation;
+	EDungeonObjectAlign objectAlignement;
+
+	FDungeonObject()
+		:objectType(EDungeonObjectType::FLOOR)
+		, rotation(1, 0, 0)
+		, objectAlignement(EDungeonObjectAlign::CENTER)
+	{
+
+	}
+
+	FDungeonObject(EDungeonObjectType type, EDungeonObjectAlign align, FVector rot)
+		:objectType(type)
+		, rotation(rot)
+		, objectAlignement(align)
+	{
+
+	}
+};
+
+/*Packed tile of the grid, the position follows from the tile index and the objects to spawn from the type and wall mask.
+Bit n of the wall mask is a wall aligned to EDungeonObjectAlign(n), so LEFT, RIGHT, TOP and BOTTOM use the low 4 bits.*/
+struct FTile
+{
+	ETileType tileType;
+	uint8 wallMask;
+	int corridorID;
+
+	FTile()
+		:tileType(ETileType::EMPTY),
+		wallMask(0),
+		corridorID(-1)
+	{
+
+	}
+
+	FTile(ETileType tileTypex, int corridorIDx = -1)
+		:tileType(tileTypex),
+		wallMask(0),
+		corridorID(corridorIDx)
+	{
+
+	}
+
+	bool HasWall(EDungeonObjectAlign align) const { return (wallMask & (1 << uint8(align))) != 0; }
+	void AddWall(EDungeonObjectAlign align) { wallMask |= 1 << uint8(align); }
+};
+
+/*Corridor between 2 sister spaces, a path of tile coordinates where every 2 consecutive points are a segment.
+A segment that is not along a row or column is filled as an L, first along the row and then along the column.
+The points are stored in the corridor itself, so the corridors of different subtrees can be made at the same time.*/
+struct FCorridor
+{
+	static constexpr int MaxPoints = 4;
+
+	FIntPoint points[MaxPoints];
+	int nrOfPoints;
+	ESeperation seperation;
+	bool isUsed;
+
+	FCorridor()
+		:nrOfPoints(0)
+		, seperation(ESeperation::VERTICAL)
+		, isUsed(false)
+	{
+
+	}
+
+	void AddPoint(const FIntPoint& point)
+	{
+		check(nrOfPoints < MaxPoints);
+		points[nrOfPoints++] = point;
+	}
+};
+
+/*Read only view of the tile types and wall masks of a grid, row by row. The values of 1 plane are Stride bytes apart,
+so the view works on the FTile array of a generator as well as on the separate planes of a loaded layout file.*/
+struct FDungeonTilePlanes
+{
+	const uint8* TileTypes = nullptr;
+	const uint8* WallMasks = nullptr;
+	int Stride = 1;
+	int TileRows = 0;
+
+	ETileType GetTileType(int tileIndex) const { return ETileType(TileTypes[tileIndex * Stride]); }
+	uint8 GetWallMask(int tileIndex) const { return WallMasks[tileIndex * Stride]; }
+};
+
+struct FData
+{
+	int key;
+	int width;
+	int height;
+	int left;
+	int bottom;
+	ESeperation seperation;
+	int tilesSeperated;
+
+};
+
+/*A node of the BSP tree. The tree is stored in a flat array in heap order, the children of the space at index i
+are at 2i + 1 (left or top) and 2i + 2 (right or bottom), so the key of a space is its index.*/
+struct FSpace
+{
+	FData data;
+	bool isUsed;
+
+	FSpace()
+		:data()
+		, isUsed(false)
+	{
+
+	}
+};
+
+/*The settings of the binary space partitioning dungeon, see ADungeonSpace for the meaning of each setting.*/
+struct FBSPDungeonSettings
+{
+	int Seed = 0;
+	int DungeonSize = 36000;
+	int SplitIterations = 5;
+	int TileSize = 600;
+	int MinTilesPerRoom = 2;
+	float MinRoomRatio = 0.4f;
+	int WallTileWidth = 10;
+	int ParallelSplitDepth = 0;
+	/*Tiles on the border of the grid that are connected to the closest room by a corridor and get no wall towards the outside of the grid.
+	Used by FDungeonChunkLayout to connect the chunks of a streamed dungeon.*/
+	TArray<FIntPoint> DoorTiles = {};
+};
+
+/*Binary space partitioning dungeon generator without any engine dependency.
+Splits the dungeon space, shrinks the leaf spaces to rooms, connects the sister spaces with corridors
+and fills the tile grid with the floors and walls to spawn.*/
+class DUNGEONGENERATIONCORE_API FBSPDungeonGenerator
+{
+public:
+	explicit FBSPDungeonGenerator(const FBSPDungeonSettings& settings);
+
+	/*Returns false when the generation was cancelled.*/
+	bool GenerateDungeon();
+	/*Transforms (relative to the dungeon) and custom data of all floor and wall meshes of the generated dungeon.
+	The scale of the base transform is kept, the location and rotation are set per mesh.*/
+	void GetMeshInstances(const FTransform& baseTransform, FDungeonMeshInstances& outMeshes) const;
+	/*Same meshes as above, built from tile planes without a generator, used for layouts loaded with FDungeonLayoutFile.*/
+	static void GetMeshInstances(const FDungeonTilePlanes& planes, int tileSize, int wallTileWidth, const FTransform& baseTransform, FDungeonMeshInstances& outMeshes);
+	/*Can be called from any thread, the generation stops at the next phase or loop iteration.*/
+	void Cancel() { IsCancelRequested = true; }
+	bool IsCancelled() const { return IsCancelRequested; }
+	void PrintTree(FString& string) const;
+
+	const FBSPDungeonSettings& GetSettings() const { return Settings; }
+	const TArray<FTile>& GetTiles() const { return TileArray; }
+	int GetTileRows() const { return TileRows; }
+	/*Left and bottom of the tile, relative to the dungeon.*/
+	FIntPoint GetTileLocation(int tileIndex) const { return FIntPoint((tileIndex % TileRows) * Settings.TileSize, (tileIndex / TileRows) * Settings.TileSize); }
+	/*The floor and walls to spawn on the tile, the floor is first.*/
+	void GetObjectsToSpawn(int tileIndex, TArray<FDungeonObject, TInlineAllocator<5>>& outObjects) const;
+	static void GetObjectsToSpawn(ETileType tileType, uint8 wallMask, TArray<FDungeonObject, TInlineAllocator<5>>& outObjects);
+	/*The rooms in tiles, the max of a rect is the first column and row after the room.*/
+	void GetRoomTileRects(TArray<FIntRect>& outRooms) const;
+	/*The heap memory used by the tree, corridors and tiles of the generator.*/
+	SIZE_T GetAllocatedSize() const;
+	const FDungeonGenerationReport& GetReport() const { return Report; }
+
+private:
+	FBSPDungeonSettings Settings;
+	TArray<FSpace> Spaces = {}; //the BSP tree in heap order, one element per possible space
+	TArray<int> DungeonRooms = {}; //keys of the spaces that became a room
+	TArray<FCorridor> DungeonCorridors = {}; //one element per possible space, used at the key of the left (odd) space of a split that has both spaces
+	TArray<FTile> TileArray = {};
+	int TileRows = 0;
+	TArray<uint64> Occupancy = {}; //1 bit per tile that is not empty, OccupancyWordsPerRow words per row of tiles
+	int OccupancyWordsPerRow = 0;
+	FDungeonRandomStream RandomStream;
+	FDungeonGenerationReport Report = {};
+	int NrOfSpaces = 0;
+	FThreadSafeBool IsCancelRequested = false;
+	static constexpr uint32 RootStreamID = 0;
+	static constexpr uint32 SplitStreamID = 1;
+	static constexpr uint32 RoomStreamID = 2;
+
+	void SplitSpace(int index, int maxElements, FData spaceData, int currentDepth);
+	FData GetChildSpaceData(const FData& parentData, bool isLeftChild) const;
+	bool CanSpaceBeUsed(const FData& spaceData) const;
+	void PrintTree(FString& string, int index) const;
+	void SelectDungeonRooms(int index, int currentDepth);
+	void FillTileGrid();
+	void FillTileSpan(int row, int firstCol, int lastCol, ETileType tileType, int corridorID);
+	void FillCorridorSegment(const FIntPoint& from, const FIntPoint& to, int corridorID);
+	/*Connects every door tile to the closest room, the corridor leaves the border of the grid straight.*/
+	void FillDoorCorridors();
+	/*Removes the walls of the door tiles towards the outside of the grid, run after PlaceWalls.*/
+	void OpenDoorTiles();
+	void ShrinkSpaceToRoom(FSpace& currentSpace);
+	bool IsSpaceUsed(int index) const { return Spaces.IsValidIndex(index) && Spaces[index].isUsed; }
+	bool IsCorridorConnected(int tileIndex) const;
+	/*Sets the wall mask of every tile in one pass over the occupancy bitmap filled by FillTileGrid.*/
+	void PlaceWalls();
+};
@@ -0,0 +1,27 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "BSPDungeonGenerator.h"
+
+/*Splits an endless dungeon into square chunks of DungeonSize, every chunk is a BSP dungeon generated from the world seed and its chunk coordinate only.
+Two neighbouring chunks share a door on their common edge, both compute the same row or column for it,
+so their corridors meet at the seam without either chunk knowing about the other.*/
+struct DUNGEONGENERATIONCORE_API FDungeonChunkLayout
+{
+	/*The settings of the chunk, the world settings with the seed of the chunk and a door tile on each of the 4 borders.*/
+	static FBSPDungeonSettings GetChunkSettings(const FBSPDungeonSettings& worldSettings, const FIntPoint& chunk);
+	static int32 GetChunkSeed(int32 worldSeed, const FIntPoint& chunk);
+	/*Row (vertical edge) or column (horizontal edge) of the door between the chunk and its right (vertical) or top (horizontal) neighbour.
+	The corners are never used, so a door always has a tile of the same border on both sides.*/
+	static int GetEdgeDoor(int32 worldSeed, const FIntPoint& chunk, bool isVerticalEdge, int tileRows);
+	/*Left and bottom of the chunk, relative to the streamed dungeon.*/
+	static FVector GetChunkOrigin(const FIntPoint& chunk, int dungeonSize) { return FVector(float(chunk.X) * dungeonSize, float(chunk.Y) * dungeonSize, 0.f); }
+	static FIntPoint GetChunk(const FVector& location, int dungeonSize) { return FIntPoint(FMath::FloorToInt(location.X / dungeonSize), FMath::FloorToInt(location.Y / dungeonSize)); }
+
+private:
+	static constexpr uint32 ChunkStreamID = 0;
+	static constexpr uint32 VerticalEdgeStreamID = 1;
+	static constexpr uint32 HorizontalEdgeStreamID = 2;
+};
@@ -0,0 +1,10 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Stats/Stats.h"
+
+DUNGEONGENERATIONCORE_API DECLARE_LOG_CATEGORY_EXTERN(LogDungeonGeneration, Log, All);
+
+DECLARE_STATS_GROUP(TEXT("DungeonGeneration"), STATGROUP_DungeonGeneration, STATCAT_Advanced);
@@ -0,0 +1,54 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/*Timings of the generation phases and counters of one generated dungeon.
+Written as JSON or as a CSV row so the numbers of different builds can be compared.*/
+struct DUNGEONGENERATIONCORE_API FDungeonGenerationReport
+{
+	struct FPhase
+	{
+		FString Name;
+		double Milliseconds;
+	};
+
+	struct FCounter
+	{
+		FString Name;
+		int64 Value;
+	};
+
+	FString GeneratorName = {};
+	int Seed = 0;
+	TArray<FPhase> Phases = {};
+	TArray<FCounter> Counters = {};
+
+	void Reset(const TCHAR* generatorName, int seed);
+	void AddPhase(const TCHAR* name, double milliseconds);
+	void SetCounter(const TCHAR* name, int64 value);
+	/*Returns 0 when the counter was not set.*/
+	int64 GetCounter(const TCHAR* name) const;
+	/*Returns 0 when the phase was not added.*/
+	double GetPhaseMilliseconds(const TCHAR* name) const;
+	double GetTotalMilliseconds() const;
+
+	FString ToJson() const;
+	FString ToCsvHeader() const;
+	FString ToCsvRow() const;
+	/*Appends the report as a CSV row, the header is written when the file is new.*/
+	bool AppendToCsvFile(const FString& filePath) const;
+};
+
+/*Adds the time between construction and destruction as a phase to the report.*/
+struct DUNGEONGENERATIONCORE_API FDungeonGenerationPhaseScope
+{
+	FDungeonGenerationPhaseScope(FDungeonGenerationReport& report, const TCHAR* name);
+	~FDungeonGenerationPhaseScope();
+
+private:
+	FDungeonGenerationReport& Report;
+	const TCHAR* Name;
+	double StartTime;
+};
@@ -0,0 +1,86 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Misc/SecureHash.h"
+#include "BSPDungeonGenerator.h"
+#include "RRPDungeonGenerator.h"
+
+struct FDungeonLayoutCacheStats
+{
+	int64 MemoryHits = 0;
+	int64 DiskHits = 0;
+	int64 Misses = 0;
+	int64 MemoryEvictions = 0;
+	int64 DiskEvictions = 0;
+	int64 MemoryBytes = 0;
+	int64 DiskBytes = 0;
+	int NrOfMemoryEntries = 0;
+	int NrOfDiskEntries = 0;
+};
+
+/*Content addressed cache of generated dungeon meshes, the key is a hash of the generator, the seed and every setting that changes the meshes.
+A memory tier keeps the meshes ready to add to the instanced static mesh components, a disk tier keeps them over sessions.
+Both tiers evict the least recently used dungeons when they get over their size limit. All functions can be called from any thread.*/
+class DUNGEONGENERATIONCORE_API FDungeonLayoutCache
+{
+public:
+	explicit FDungeonLayoutCache(const FString& directory);
+
+	/*The cache shared by all dungeons, stored in Saved/DungeonGeneration/LayoutCache.*/
+	static FDungeonLayoutCache& Get();
+
+	/*ParallelSplitDepth is not part of the key, the dungeon is the same for any depth. The scale is the scale of the base transform of the meshes.*/
+	static FSHAHash GetKey(const FBSPDungeonSettings& settings, const FVector& meshScale);
+	static FSHAHash GetKey(const FRRPDungeonSettings& settings);
+
+	/*Looks in memory first and then on disk, a dungeon found on disk is kept in memory as well.*/
+	bool Find(const FSHAHash& key, FDungeonMeshInstances& outMeshes);
+	void Add(const FSHAHash& key, const FDungeonMeshInstances& meshes);
+	/*A limit of 0 turns the tier off, the dungeons over the new limits are evicted right away.*/
+	void SetLimits(int64 maxMemoryBytes, int64 maxDiskBytes);
+	/*Removes every dungeon from memory and disk, the counters are kept.*/
+	void Empty();
+	FDungeonLayoutCacheStats GetStats() const;
+	/*Sets the hit, miss and eviction counters of the cache in the report.*/
+	void AddCounters(FDungeonGenerationReport& report) const;
+
+private:
+	struct FMemoryEntry
+	{
+		TSharedPtr<const FDungeonMeshInstances, ESPMode::ThreadSafe> Meshes;
+		int64 Bytes;
+		uint64 LastUsed;
+	};
+
+	struct FDiskEntry
+	{
+		int64 Bytes;
+		int64 LastUsed; //UTC ticks, the same as the time stamp of the file so the order is kept over sessions
+	};
+
+	mutable FCriticalSection Lock; //the files are read and written outside the lock
+	FString Directory;
+	TMap<FSHAHash, FMemoryEntry> MemoryEntries = {};
+	TMap<FSHAHash, FDiskEntry> DiskEntries = {};
+	bool IsDiskScanned = false;
+	int64 MaxMemoryBytes = 256 * 1024 * 1024;
+	int64 MaxDiskBytes = 1024 * 1024 * 1024;
+	uint64 MemoryUseCounter = 0;
+	FDungeonLayoutCacheStats Stats = {};
+	static constexpr uint32 FileMagic = 0x43474444; //"DDGC"
+	static constexpr int32 FileVersion = 1;
+	static constexpr int32 KeyVersion = 1; //bump when a generator gives other meshes for the same settings
+
+	static FSHAHash GetKey(const TArray<uint8>& keyBytes);
+	static int64 GetAllocatedBytes(const FDungeonMeshInstances& meshes);
+	static void SerializeMeshes(FArchive& ar, FSHAHash& key, FDungeonMeshInstances& meshes);
+	FString GetFilePath(const FSHAHash& key) const;
+	/*The functions below are called with the lock held.*/
+	void ScanDisk();
+	void AddToMemory(const FSHAHash& key, const TSharedPtr<const FDungeonMeshInstances, ESPMode::ThreadSafe>& meshes, int64 bytes);
+	void EvictMemory();
+	void EvictDisk();
+	void RemoveFromDisk(const FSHAHash& key);
+};
@@ -0,0 +1,75 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "BSPDungeonGenerator.h"
+
+class IMappedFileHandle;
+class IMappedFileRegion;
+
+/*Start of a layout file. The blocks after the header start at 8 byte aligned offsets:
+a tile type plane and a wall mask plane of TileRows * TileRows bytes, NrOfRooms FIntRect in tiles and NrOfDoors FIntPoint in tiles.
+Every value is little endian, the format is read in place, so the structs must never change layout within a version.
+A newer version may only add fields at the end of the header and blocks after the ones above, so older builds can still read the fields they know.
+A change that breaks that needs a new Magic.*/
+struct FDungeonLayoutHeader
+{
+	uint32 Magic;
+	uint16 Version;
+	uint16 HeaderSize; //newer versions can add fields at the end of the header, the fields after HeaderSize bytes are skipped
+	int32 Seed;
+	int32 TileRows;
+	int32 TileSize;
+	int32 WallTileWidth;
+	int32 NrOfRooms;
+	int32 NrOfDoors;
+	uint64 TileTypesOffset;
+	uint64 WallMasksOffset;
+	uint64 RoomsOffset;
+	uint64 DoorsOffset;
+	uint64 FileSize;
+};
+
+/*Compact versioned binary file of a generated BSP dungeon layout, so a dungeon can be stored and loaded instead of generated again.*/
+struct DUNGEONGENERATIONCORE_API FDungeonLayoutFile
+{
+	static constexpr uint32 Magic = 0x4C4E4744; //"DGNL"
+	static constexpr uint16 Version = 1;
+
+	static void Write(const FBSPDungeonGenerator& generator, TArray<uint8>& outBytes);
+	static bool SaveToFile(const FBSPDungeonGenerator& generator, const FString& fileName);
+	/*Returns the header when the bytes are a complete layout this build can read, nullptr otherwise. Newer versions are read as far as this version knows them.
+	The header, the block bounds and the tile types are checked, the other blocks are used without parsing.*/
+	static const FDungeonLayoutHeader* GetHeader(const uint8* bytes, int64 nrOfBytes);
+};
+
+/*A layout file mapped into memory. The tile planes, rooms and doors point straight into the mapped file,
+when the platform can not map files the file is read into memory once instead.*/
+class DUNGEONGENERATIONCORE_API FMappedDungeonLayout
+{
+public:
+	FMappedDungeonLayout();
+	~FMappedDungeonLayout();
+	FMappedDungeonLayout(const FMappedDungeonLayout&) = delete;
+	FMappedDungeonLayout& operator=(const FMappedDungeonLayout&) = delete;
+
+	/*Returns false when the file can not be opened or is not a valid layout.*/
+	bool Open(const FString& fileName);
+	void Close();
+	bool IsOpen() const { return Header != nullptr; }
+
+	const FDungeonLayoutHeader& GetHeader() const { check(Header); return *Header; }
+	FDungeonTilePlanes GetTilePlanes() const;
+	TArrayView<const FIntRect> GetRooms() const;
+	TArrayView<const FIntPoint> GetDoors() const;
+	/*The floor and wall meshes of the layout, with the same rules as FBSPDungeonGenerator::GetMeshInstances.*/
+	void GetMeshInstances(const FTransform& baseTransform, FDungeonMeshInstances& outMeshes) const;
+
+private:
+	TUniquePtr<IMappedFileHandle> MappedFile;
+	TUniquePtr<IMappedFileRegion> MappedRegion;
+	TArray<uint8> LoadedBytes = {}; //only used when the file could not be mapped
+	const uint8* Bytes = nullptr;
+	const FDungeonLayoutHeader* Header = nullptr;
+};
@@ -0,0 +1,17 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/*The floor and wall meshes of a generated dungeon. Filled by the generators (on any thread)
+and added to the instanced static mesh components by the dungeon actors on the game thread.*/
+struct FDungeonMeshInstances
+{
+	TArray<FTransform> FloorTransforms = {};
+	TArray<float> FloorCustomData = {}; //one value per floor, empty when the generator has no custom data
+	TArray<FTransform> WallTransforms = {};
+	TArray<float> WallCustomData = {}; //one value per wall, empty when the generator has no custom data
+
+	int Num() const { return FloorTransforms.Num() + WallTransforms.Num(); }
+};
@@ -0,0 +1,32 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/*Counter-based random stream: every number is a hash of the stream key and a counter, so there is no shared state.
+Split gives an independent substream for a part of the generation (a BSP node, a room, ...),
+which makes the result independent of the order or the thread the parts are generated on.*/
+struct DUNGEONGENERATIONCORE_API FDungeonRandomStream
+{
+	FDungeonRandomStream();
+	explicit FDungeonRandomStream(int32 seed);
+
+	FDungeonRandomStream Split(uint32 streamID) const;
+
+	uint32 GetUnsignedInt();
+	float GetFraction();
+
+	/*Random integer between min and max (inclusive), same range as FMath::RandRange.*/
+	int32 RandRange(int32 min, int32 max);
+	/*Random float between min and max, same range as FMath::FRandRange.*/
+	float FRandRange(float min, float max);
+
+private:
+	static constexpr uint64 GoldenGamma = 0x9E3779B97F4A7C15ull;
+
+	uint64 Key;
+	uint64 Counter;
+
+	static uint64 Mix(uint64 value);
+};
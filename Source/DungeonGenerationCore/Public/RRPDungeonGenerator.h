@@ -0,0 +1,431 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "DungeonRandomStream.h"
+#include "DungeonGenerationReport.h"
+#include "DungeonMeshInstances.h"
+#include "HAL/ThreadSafeBool.h"
+
+enum class ETileNodeType : uint8 {
+	EMPTY = 0,
+	ROOM = 1,
+	CORRIDOR = 2,
+	DOOR = 3,
+};
+
+/*Same values as ECorridorType of ARRPDungeon.*/
+enum class ERRPCorridorType : uint8 {
+	RANDOMROOMCONNECT = 0,
+	MINIMUMSPANNINGTREE = 1,
+};
+
+/*Same values as EPathfindingMode of ARRPDungeon.*/
+enum class ERRPPathfindingMode : uint8 {
+	SEQUENTIAL = 0,
+	PARALLEL = 1,
+};
+
+/*Same values as EPathfindingAlgorithm of ARRPDungeon.*/
+enum class ERRPPathfindingAlgorithm : uint8 {
+	ASTAR = 0,
+	JUMPPOINTSEARCH = 1,
+	HIERARCHICAL = 2,
+};
+
+/*Same values as ESeperationMode of ARRPDungeon.*/
+enum class ERRPSeperationMode : uint8 {
+	SEQUENTIAL = 0,
+	PARALLEL = 1,
+};
+
+/*Same values as EHeuristicCost of ARRPDungeon.*/
+enum class ERRPHeuristicCost : uint8 {
+	MANHATTAN = 0,
+	EUCLIDEAN = 1,
+	SQRTEUCLIDEAN = 2,
+	OCTILE = 3,
+	CHEBYSHEV = 4,
+	ADMISSIBLEMANHATTAN = 5, //Manhattan distance in TileNodes times the cheapest connection cost, never more than the real cost
+};
+
+/*Dense row-major grid of TileNodes, stored as structure-of-arrays. The NodeID of a tile is row * NrOfCols + col,
+adjacent tiles are found with index arithmetic in the order of the AdjacentDirections (col + 1, row + 1, col - 1, row - 1).*/
+struct DUNGEONGENERATIONCORE_API FTileNodeGrid
+{
+	static constexpr int NrOfDirections = 4;
+
+	TArray<ETileNodeType> TileNodeTypes = {};
+	TArray<FVector> TilePositions = {};
+	TArray<float> ConnectionCosts = {}; //NrOfDirections costs per node, the cost to go from the node to the adjacent node
+	int NrOfCols = 0;
+	int NrOfRows = 0;
+
+	void Init(int nrOfCols, int nrOfRows, float connectionCost);
+	void Empty();
+	int Num() const { return TileNodeTypes.Num(); }
+	bool IsValidNodeID(int nodeID) const { return TileNodeTypes.IsValidIndex(nodeID); }
+	int GetAdjacentNodeID(int nodeID, int direction) const;
+	float& GetConnectionCost(int nodeID, int direction) { return ConnectionCosts[nodeID * NrOfDirections + direction]; }
+	float GetConnectionCost(int nodeID, int direction) const { return ConnectionCosts[nodeID * NrOfDirections + direction]; }
+	static int GetOppositeDirection(int direction) { return (direction + 2) % NrOfDirections; }
+};
+
+enum class ETileNodeRecordState : uint8 {
+	UNVISITED = 0,
+	OPEN = 1,
+	CLOSED = 2,
+};
+
+/*A* state of 1 TileNode, indexed on the TileNode. The paths are the same as the old list based search as long as no closed record is
+forgotten, which only happens with an inconsistent heuristic such as the default Manhattan in world units. Then the old search dropped the record,
+stopped the path reconstruction at it and could open it again from a stale duplicate record. This search keeps the old parent and cost of a forgotten
+record and only opens it again from a new connection, so those paths can differ.*/
+struct FTileNodeRecord
+{
+	int FromNodeID;
+	float CostSoFar;
+	float EstimatedTotalCost;
+	uint32 SearchID;
+	ETileNodeRecordState State;
+
+	FTileNodeRecord()
+		:FromNodeID(-1)
+		, CostSoFar(0.f)
+		, EstimatedTotalCost(0.f)
+		, SearchID(0)
+		, State(ETileNodeRecordState::UNVISITED)
+	{
+
+	}
+};
+
+/*Indexed binary min-heap on EstimatedTotalCost, used as the open list of the A* search.
+Equal costs are popped in the order they were pushed or last updated.*/
+struct DUNGEONGENERATIONCORE_API FTileNodeOpenList
+{
+	void Reset(int nrOfNodes);
+	bool IsEmpty() const { return Heap.Num() == 0; }
+	int Num() const { return Heap.Num(); }
+	void Push(int nodeID, float estimatedTotalCost);
+	void Update(int nodeID, float estimatedTotalCost);
+	int Pop();
+
+private:
+	struct FEntry
+	{
+		int NodeID;
+		float EstimatedTotalCost;
+		uint32 Order;
+	};
+
+	TArray<FEntry> Heap = {};
+	TArray<int> HeapIndices = {}; //NodeID -> index in Heap, INDEX_NONE when not on the open list
+	uint32 NextOrder = 0;
+
+	bool IsLess(const FEntry& a, const FEntry& b) const;
+	void SiftUp(int heapIndex);
+	void SiftDown(int heapIndex);
+	void Swap(int heapIndexA, int heapIndexB);
+};
+
+/*Scratch state of 1 A* search at a time. Every thread that searches uses its own, the counters are added up afterwards.*/
+struct FTileNodeSearch
+{
+	FTileNodeOpenList OpenList = {}; //keyed on the index of the TileNode in the Window
+	TArray<FTileNodeRecord> TileNodeRecords = {}; //1 record per TileNode of the Window
+	FIntRect Window = {}; //the columns and rows the current search can expand, Max is exclusive
+	uint32 SearchID = 0;
+	int NrOfPathSearches = 0;
+	int64 NrOfNodesExpanded = 0;
+	int OpenListPeakSize = 0;
+	int NrOfSearchWindowFallbacks = 0;
+	double TotalPathCost = 0.0; //the cost of all found paths, to compare the path algorithms
+	TArray<FTileNodeRecord> EntranceRecords = {}; //1 record per entrance of the cluster graph plus the start and end TileNode
+	TArray<float> StartClusterCosts = {}; //costs from the start TileNode to the TileNodes of its cluster
+	TArray<float> EndClusterCosts = {}; //costs from the TileNodes of the end cluster to the end TileNode
+	TArray<int> Waypoints = {}; //the TileNodes of the abstract path, refined cluster by cluster
+};
+
+/*Abstract graph of the hierarchical (HPA*) search. The TileNode grid is split in square clusters, the TileNodes on both sides
+of a cluster border become entrances. The edges between the entrances of 1 cluster cost as much as the cheapest path inside the cluster,
+the edges over a border use the connection cost of the grid. The entrances are placed once, a cluster whose connection costs changed
+is marked dirty and only its edges are calculated again.*/
+struct DUNGEONGENERATIONCORE_API FTileNodeClusterGraph
+{
+	struct FEdge
+	{
+		int ToEntrance;
+		float Cost;
+	};
+
+	struct FBorderEdge
+	{
+		int ToEntrance;
+		int Direction; //the direction of the connection in the grid from the entrance to ToEntrance
+	};
+
+	void Build(const FTileNodeGrid& grid, int clusterSize, FTileNodeOpenList& openList, TArray<float>& costs);
+	void Empty();
+	bool IsBuilt() const { return ClusterSize > 0; }
+	int GetClusterIndex(int nodeID) const;
+	FIntRect GetClusterRect(int clusterIndex) const;
+	void MarkDirty(int nodeID);
+	/*Calculates the edges of the dirty clusters again, returns the number of clusters.*/
+	int UpdateDirtyClusters(const FTileNodeGrid& grid, FTileNodeOpenList& openList, TArray<float>& costs);
+	/*Dijkstra inside the rect from the TileNode, or to the TileNode when isReversed. The costs are indexed on the TileNode in the rect, unreachable is MAX_FLT.*/
+	static void GetCostsInRect(const FTileNodeGrid& grid, const FIntRect& rect, int nodeID, bool isReversed, FTileNodeOpenList& openList, TArray<float>& outCosts);
+	static int GetIndexInRect(const FTileNodeGrid& grid, const FIntRect& rect, int nodeID);
+
+	int ClusterSize = 0;
+	int NrOfClusterCols = 0;
+	int NrOfClusterRows = 0;
+	TArray<int> EntranceNodeIDs = {}; //the TileNode of every entrance
+	TArray<TArray<FBorderEdge>> BorderEdges = {}; //per entrance, the edges to the entrances of the adjacent clusters
+	TArray<TArray<FEdge>> ClusterEdges = {}; //per entrance, the edges to the other entrances of its cluster
+	TArray<TArray<int>> ClusterEntrances = {}; //per cluster, its entrances
+
+private:
+	int NrOfGridCols = 0;
+	int NrOfGridRows = 0;
+	TMap<int, int> NodeEntrances = {}; //NodeID -> entrance
+	TArray<uint8> DirtyClusters = {};
+	TArray<int> DirtyClusterIndices = {};
+	static constexpr int MinSplitEntranceLength = 6; //an empty border span at least this long gets an entrance at both ends instead of 1 in the middle
+
+	void AddBorderEntrances(const FTileNodeGrid& grid, int firstNodeID, int step, int length, int direction);
+	int GetOrAddEntrance(int nodeID);
+	void UpdateCluster(const FTileNodeGrid& grid, int clusterIndex, FTileNodeOpenList& openList, TArray<float>& costs);
+};
+
+/*Uniform grid that buckets rooms on their central position, used as broadphase by the room seperation.*/
+struct DUNGEONGENERATIONCORE_API FRoomSpatialHash
+{
+	void Init(float cellSize);
+	void Add(int roomIndex, const FVector& pos);
+	void Move(int roomIndex, const FVector& oldPos, const FVector& newPos);
+	void GetNearbyRooms(const FVector& pos, TArray<int>& outRoomIndices) const;
+
+private:
+	float CellSize = 1.f;
+	TMap<FIntPoint, TArray<int>> Cells = {};
+
+	FIntPoint GetCell(const FVector& pos) const;
+};
+
+/*Edge between 2 rooms of the room graph, Distance is the distance between the central positions.*/
+struct FRoomConnection
+{
+	int RoomA;
+	int RoomB;
+	float Distance;
+};
+
+struct FDoor
+{
+	int TileID;
+	float CorridorID;
+	FVector Direction;
+	TArray<int32> WallInstancesToRemove;
+
+	FDoor()
+		:TileID(-1)
+		, CorridorID(-1)
+		, Direction()
+	{
+		WallInstancesToRemove = {};
+	}
+};
+
+/*State of a TileNode before UpdatePremadeRooms changed it, the meshes of the TileNode only change when its state at the end is different.*/
+struct FTileNodeChange
+{
+	int NodeID;
+	ETileNodeType OldType;
+	bool WasInRoom;
+	bool HadDoor;
+	FVector OldDoorDirection;
+
+	FTileNodeChange()
+		:NodeID(-1)
+		, OldType(ETileNodeType::EMPTY)
+		, WasInRoom(false)
+		, HadDoor(false)
+		, OldDoorDirection(0, 0, 0)
+	{
+
+	}
+};
+
+struct FRRPRoom
+{
+	int RoomID;
+	float Width;
+	float Height;
+	FVector CentralPosition;
+	TArray<int> TileNodesOfRoom;
+
+	FRRPRoom()
+		:RoomID(0)
+		, Width(0)
+		, Height(0)
+		, CentralPosition(0, 0, 0)
+	{
+		TileNodesOfRoom = {};
+	}
+};
+
+/*The settings of the random room placement dungeon, see ARRPDungeon for the meaning of each setting.*/
+struct FRRPDungeonSettings
+{
+	int Seed = 0;
+	FVector DungeonCentralPosition = FVector::ZeroVector;
+	float DungeonRadius = 6000;
+	float RoomTileSize = 600;
+	int MinRoomTiles = 2;
+	int MaxRoomTiles = 8;
+	int NrOfRooms = 12;
+	TArray<FRRPRoom> PremadeRooms = {};
+	float EmptyTileConnectionCost = 1.f;
+	float CorridorConnectionCost = 100;
+	float RoomConnectionCost = 550;
+	ERRPHeuristicCost HeuresticCostFunction = ERRPHeuristicCost::MANHATTAN;
+	ERRPSeperationMode SeperationMode = ERRPSeperationMode::SEQUENTIAL;
+	int MaxSeperationIterations = 1000;
+	ERRPCorridorType CorridorType = ERRPCorridorType::RANDOMROOMCONNECT;
+	float ExtraConnectionFraction = 0.15f;
+	int SearchWindowMargin = 0;
+	ERRPPathfindingMode PathfindingMode = ERRPPathfindingMode::SEQUENTIAL;
+	ERRPPathfindingAlgorithm PathfindingAlgorithm = ERRPPathfindingAlgorithm::ASTAR;
+	int ClusterSize = 16;
+};
+
+/*Random room placement dungeon generator without any engine dependency.
+Places and seperates the rooms, builds the TileNode grid, connects the rooms with A* corridors
+and calculates where the floor and wall meshes go.*/
+class DUNGEONGENERATIONCORE_API FRRPDungeonGenerator
+{
+public:
+	explicit FRRPDungeonGenerator(const FRRPDungeonSettings& settings);
+
+	/*Returns false when the generation was cancelled.*/
+	bool GenerateDungeon();
+	/*World space transforms of all floor and wall meshes of the generated dungeon.*/
+	void GetMeshInstances(FDungeonMeshInstances& outMeshes) const;
+	/*World space transforms of the floor and wall meshes of the given TileNodes only, with the same rules as GetMeshInstances.*/
+	void GetMeshInstancesOfTileNodes(const TArray<int>& nodeIDs, FDungeonMeshInstances& outMeshes) const;
+	/*Applies changed premade rooms to the generated dungeon instead of generating it again. The premade rooms are matched on RoomID,
+	only the corridors of changed rooms and the corridors that cross their old or new area are searched again, the other corridors keep their path.
+	Only the area of the changed rooms and of the corridors that are not kept is cleared and stamped again, the rest of the grid is not touched.
+	Returns false when the whole dungeon has to be generated, because there is no dungeon yet or a room does not fit in the TileNode grid.*/
+	bool UpdatePremadeRooms(const TArray<FRRPRoom>& premadeRooms);
+	/*The TileNodes whose floor or walls can be different after the last UpdatePremadeRooms.*/
+	const TArray<int>& GetDirtyTileNodes() const { return DirtyTileNodes; }
+	/*Appends the TileNodes inside the box (world space).*/
+	void GetTileNodesInBox(const FBox2D& box, TArray<int>& outNodeIDs) const;
+	/*Searches every corridor of the generated dungeon again on the finished TileNode grid, once with A* and once with Jump Point Search,
+	both with the admissible heuristic so both find the cheapest path. Returns the number of corridors whose 2 paths have a different cost, the grid is not changed.*/
+	int GetNrOfDifferentPathCosts();
+	/*Can be called from any thread, the generation stops at the next phase or loop iteration.*/
+	void Cancel() { IsCancelRequested = true; }
+	bool IsCancelled() const { return IsCancelRequested; }
+
+	const FRRPDungeonSettings& GetSettings() const { return Settings; }
+	const TArray<FRRPRoom>& GetRooms() const { return ArrayOfRooms; }
+	const FTileNodeGrid& GetTileNodeGrid() const { return TileNodeGrid; }
+	bool HasOverlap() const { return HasOverlappingRooms; }
+	int GetNrOfSeperationIterations() const { return NrOfSeperationIterations; }
+	const FDungeonGenerationReport& GetReport() const { return Report; }
+
+private:
+	FRRPDungeonSettings Settings;
+	FDungeonRandomStream RandomStream;
+	TArray<FRRPRoom> ArrayOfRooms = {};
+	FTileNodeGrid TileNodeGrid = {};
+	TMap<int, TArray<int>> CorridorTiles = {};
+	TArray<FVector> AdjacentDirections = { { 1, 0, 0 }, { 0, 1, 0 }, { -1, 0, 0 }, { 0, -1, 0 } };
+	TMap<int, FDoor> DoorTiles = {};
+	TArray<int> RoomOfTileNode = {}; //index in ArrayOfRooms per TileNode, INDEX_NONE when the TileNode is not part of a room
+	TArray<FRoomConnection> CorridorConnections = {}; //the connection of every corridor, indexed on the corridor ID
+	TArray<TArray<int>> CorridorPaths = {}; //the path every corridor was committed with, indexed on the corridor ID
+	TArray<int> DirtyTileNodes = {};
+	TArray<uint8> TilesChangedByUpdate = {}; //TileNodeChanged and TileNodeDirty flags per TileNode, only set during UpdatePremadeRooms
+	TArray<FTileNodeChange> ChangedTileNodes = {}; //the TileNodes changed by the current update, with their state before it
+	bool HasOverlappingRooms = false;
+	int NrOfSeperationIterations = 0;
+	FRoomSpatialHash RoomSpatialHash = {};
+	TArray<FVector> SeperationPushes = {};
+	TArray<uint8> RoomsOverlapping = {};
+	float TopOfGrid = FLT_MAX;
+	float BotOfGrid = FLT_MIN;
+	float RightOfGrid = FLT_MIN;
+	float LeftOfGrid = FLT_MAX;
+	int NrOfGridCols = 0;
+	int NrOfGridRows = 0;
+	FTileNodeClusterGraph ClusterGraph = {}; //only built for the hierarchical search
+	FTileNodeSearch PathSearch = {}; //used by the sequential searches and to search conflicting paths again, the counters of the parallel searches are added to it
+	TArray<uint8> TilesChangedByCommit = {}; //TileNodes changed by the corridors committed from the current batch of parallel searches
+	FDungeonGenerationReport Report = {};
+	FThreadSafeBool IsCancelRequested = false;
+	int NrOfRoomConnections = 0;
+	int NrOfPathConflicts = 0;
+	int NrOfClusterUpdates = 0;
+	static constexpr uint32 ConnectionStreamID = MAX_uint32; //the rooms use the stream ids from 0
+	static constexpr uint8 TileNodeChanged = 1;
+	static constexpr uint8 TileNodeDirty = 2;
+
+	void GenerateRooms();
+	bool SeperateRooms();
+	bool SeperateRoomsSequential(TArray<int>& candidateRooms);
+	bool SeperateRoomsParallel();
+	FVector GetSeperationPush(int roomIndex, TArray<int>& candidateRooms, bool& isOverlapping) const;
+	void ContructTileNodeGrid();
+	void AttachTileNodesToRooms();
+	void AttachTileNodesToRoom(int roomIndex);
+	void GetTileNodesOfRoom(const FRRPRoom& room, TArray<int>& outNodeIDs) const;
+	void RandomRoomConnect();
+	void MinimumSpanningTreeConnect();
+	void GetRoomConnections(TArray<FRoomConnection>& outConnections) const;
+	void GetRandomRoomConnections(TArray<FRoomConnection>& outConnections) const;
+	void GetMinimumSpanningTreeConnections(TArray<FRoomConnection>& outConnections) const;
+	void GetDelaunayConnections(TArray<FRoomConnection>& outConnections) const;
+	void GetMinimumSpanningTree(TArray<FRoomConnection>& connections, TArray<FRoomConnection>& outTreeConnections, TArray<FRoomConnection>& outOtherConnections) const;
+	void ConnectRooms(const TArray<FRoomConnection>& connections);
+	void ConnectRoomsSequential(const TArray<FRoomConnection>& connections);
+	void ConnectRoomsParallel(const TArray<FRoomConnection>& connections);
+	bool GetConnectionNodeIDs(const FRoomConnection& connection, int& outStartNodeID, int& outEndNodeID) const;
+	void UpdateClusterGraph();
+	static uint64 GetConnectionKey(int roomA, int roomB);
+	void AddChangedTileNode(int nodeID);
+	void GetKeptCorridors(const TArray<FRoomConnection>& connections, const TArray<int>& oldToNewRooms, const TArray<uint8>& isRoomChanged, TMap<uint64, int>& outKeptCorridors);
+	void ClearChangedTileNodes(const TArray<FRRPRoom>& oldRooms, const TArray<int>& oldToNewRooms, const TArray<uint8>& isRoomChanged);
+	void UpdateCorridors(const TArray<FRoomConnection>& connections, TMap<uint64, int>& keptCorridors);
+	void UpdateDirtyTileNodes();
+	void CommitCorridor(const FRoomConnection& connection, TArray<int>& path);
+	void CreateCorridorFromPath(TArray<int>& path);
+	void CreateDoorTile(int currentNodeID, int nextNodeID, int corridorID);
+	void GetMeshInstancesOfTileNode(int nodeID, const TArray<ETileNodeType>& tilesTypesToIgnore, TArray<FTransform>& outFloorTransforms, TArray<FTransform>& outWallTransforms) const;
+	FVector GetRandomPointInCircle(FDungeonRandomStream& stream) const;
+	bool AreRoomsOverlapping(const FRRPRoom& roomA, const FRRPRoom& roomB, float margin) const;
+	int GetNodeIDFromPosition(const FVector& pos) const;
+	void GetPath(FTileNodeSearch& search, int startNodeID, int endNodeID, TArray<int>& outPath) const;
+	void GetPathAStar(FTileNodeSearch& search, int startNodeID, int endNodeID, TArray<int>& outPath) const;
+	void GetPathHierarchical(FTileNodeSearch& search, int startNodeID, int endNodeID, TArray<int>& outPath) const;
+	bool SearchAbstractPath(FTileNodeSearch& search, int startNodeID, int endNodeID) const;
+	void UpdateEntranceRecord(FTileNodeSearch& search, int fromEntrance, int entrance, float costSoFar, int endNodeID) const;
+	FTileNodeRecord& GetEntranceRecord(FTileNodeSearch& search, int entrance) const;
+	void AddReconstructedPath(FTileNodeSearch& search, int startNodeID, int lastNodeID, TArray<int>& outPath) const;
+	bool SearchPathAStar(FTileNodeSearch& search, int startNodeID, int endNodeID, int& outLastNodeID) const;
+	FIntRect GetSearchWindow(int startNodeID, int endNodeID, int margin) const;
+	int GetSearchWindowIndex(const FTileNodeSearch& search, int nodeID) const;
+	float GetHeuristicCost(int startNodeID, int endNodeID) const;
+	FTileNodeRecord& GetTileNodeRecord(FTileNodeSearch& search, int nodeID) const;
+	void UpdateTileNodeRecord(FTileNodeSearch& search, int fromNodeID, int nodeID, float costSoFar, int endNodeID) const;
+	bool IsUniformTileNode(int nodeID) const;
+	bool IsJumpPointInterior(const FTileNodeSearch& search, int nodeID) const;
+	void GetJumpDirections(const FTileNodeSearch& search, int fromNodeID, int nodeID, bool (&outIsJumpDirection)[FTileNodeGrid::NrOfDirections]) const;
+	int Jump(const FTileNodeSearch& search, int nodeID, int direction, int endNodeID, int& outNrOfSteps) const;
+	bool IsPositionInGrid(const FVector& pos) const;
+	bool IsNodeTileAndDoorFacingSameDirection(int nodeID, int doorNodeID) const;
+};
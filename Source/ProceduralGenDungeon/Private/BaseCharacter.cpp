@@ -96,14 +96,15 @@ void ABaseCharacter::GenerateDungeon()
 		ADungeonSpace* BSPDungeon = ((ADungeonSpace*)BSPDungeons[0]);
 		if (IsValid(BSPDungeon))
 		{
-			BSPDungeon->GenerateDungeon();
+			//Generate off the game thread, the key is ignored until the previous dungeon is spawned
+			BSPDungeon->GenerateDungeonAsync(BSPDungeon->IsUsingRandomSeed ? FMath::Rand() : BSPDungeon->Seed, FOnDungeonGenerated());
 		}
 	}
 	else if (RRPDungeons.Num() > 0) {
 		ARRPDungeon* RRPDungeon = ((ARRPDungeon*)RRPDungeons[0]);
 		if (IsValid(RRPDungeon))
 		{
-			RRPDungeon->GenerateDungeon();
+			RRPDungeon->GenerateDungeonAsync(RRPDungeon->IsUsingRandomSeed ? FMath::Rand() : RRPDungeon->Seed, FOnDungeonGenerated());
 		}
 	}
 }
@@ -0,0 +1,298 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "DungeonChunkStreamer.h"
+#include "Components/InstancedStaticMeshComponent.h"
+#include "Components/HierarchicalInstancedStaticMeshComponent.h"
+#include "Kismet/GameplayStatics.h"
+#include "DungeonInstancedMeshes.h"
+#include "DungeonChunkLayout.h"
+#include "DungeonGenerationCore.h"
+#include "Async/Async.h"
+
+DECLARE_CYCLE_STAT(TEXT("Streamer SpawnChunk"), STAT_StreamerSpawnChunk, STATGROUP_DungeonGeneration);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Streamer loaded chunks"), STAT_StreamerLoadedChunks, STATGROUP_DungeonGeneration);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Streamer chunks in flight"), STAT_StreamerChunksInFlight, STATGROUP_DungeonGeneration);
+
+// Sets default values
+ADungeonChunkStreamer::ADungeonChunkStreamer()
+{
+	// Set this actor to call Tick() every frame.  You can turn this off to improve performance if you don't need it.
+	PrimaryActorTick.bCanEverTick = true;
+
+	RootComponent = CreateDefaultSubobject<USceneComponent>(TEXT("Root"));
+
+	FloorTileISMC = CreateDefaultSubobject<class UInstancedStaticMeshComponent>(TEXT("Floor InstancedStaticMesh"));
+	FloorTileISMC->SetMobility(EComponentMobility::Static);
+	FloorTileISMC->SetCollisionProfileName("BlockAll");
+	FloorTileISMC->SetupAttachment(RootComponent);
+
+	WallTileISMC = CreateDefaultSubobject<class UInstancedStaticMeshComponent>(TEXT("Wall InstancedStaticMesh"));
+	WallTileISMC->SetMobility(EComponentMobility::Static);
+	WallTileISMC->SetCollisionProfileName("BlockAll");
+	WallTileISMC->SetupAttachment(RootComponent);
+}
+
+void ADungeonChunkStreamer::RestartStreaming(int seed)
+{
+	ReleaseAllChunks();
+	Seed = seed;
+	IsStreaming = true;
+	PlayerChunk = GetPlayerChunk();
+	RequestChunks();
+}
+
+// Called when the game starts or when spawned
+void ADungeonChunkStreamer::BeginPlay()
+{
+	Super::BeginPlay();
+
+	RestartStreaming(IsUsingRandomSeed ? FMath::Rand() : Seed);
+}
+
+void ADungeonChunkStreamer::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	//Ignore the results of the chunks that are still generating
+	IsStreaming = false;
+	ReleaseAllChunks();
+
+	Super::EndPlay(EndPlayReason);
+}
+
+FBSPDungeonSettings ADungeonChunkStreamer::GetGeneratorSettings() const
+{
+	FBSPDungeonSettings settings{};
+	settings.Seed = Seed;
+	settings.DungeonSize = DungeonSize;
+	settings.SplitIterations = SplitIterations;
+	settings.TileSize = TileSize;
+	settings.MinTilesPerRoom = MinTilesPerRoom;
+	settings.MinRoomRatio = MinRoomRatio;
+	settings.WallTileWidth = WallTileWidth;
+	return settings;
+}
+
+FIntPoint ADungeonChunkStreamer::GetPlayerChunk() const
+{
+	const APawn* pawn = UGameplayStatics::GetPlayerPawn(GetWorld(), 0);
+	if (pawn == nullptr)
+		return PlayerChunk;
+
+	return FDungeonChunkLayout::GetChunk(pawn->GetActorLocation() - GetActorLocation(), DungeonSize);
+}
+
+bool ADungeonChunkStreamer::IsInRadius(const FIntPoint& chunk, int radius) const
+{
+	return FMath::Abs(chunk.X - PlayerChunk.X) <= radius && FMath::Abs(chunk.Y - PlayerChunk.Y) <= radius;
+}
+
+void ADungeonChunkStreamer::ReleaseFarChunks()
+{
+	//the radius to release is larger than the radius to load, a chunk that is released is not requested again in the same frame
+	const int unloadRadius = FMath::Max(UnloadRadius, LoadRadius + 1);
+
+	TArray<FIntPoint> farChunks{};
+	for (auto& elem : LoadedChunks)
+	{
+		if (!IsInRadius(elem.Key, unloadRadius))
+			farChunks.Add(elem.Key);
+	}
+	for (const FIntPoint& chunk : farChunks)
+	{
+		ReleaseChunk(chunk);
+	}
+
+	//the worker of a far chunk stops at its next phase, its result is ignored. It counts against MaxChunksInFlight until it is done
+	for (auto it = ChunksInFlight.CreateIterator(); it; ++it)
+	{
+		if (!IsInRadius(it.Key(), unloadRadius))
+		{
+			it.Value()->Cancel();
+			it.RemoveCurrent();
+		}
+	}
+	for (auto it = GeneratedChunks.CreateIterator(); it; ++it)
+	{
+		if (!IsInRadius(it.Key(), unloadRadius))
+			it.RemoveCurrent();
+	}
+}
+
+void ADungeonChunkStreamer::RequestChunks()
+{
+	if (NrOfRunningWorkers >= MaxChunksInFlight)
+		return;
+
+	//the missing chunks around the player, the closest are generated first
+	TArray<FIntPoint> missingChunks{};
+	for (int y = PlayerChunk.Y - LoadRadius; y <= PlayerChunk.Y + LoadRadius; y++)
+	{
+		for (int x = PlayerChunk.X - LoadRadius; x <= PlayerChunk.X + LoadRadius; x++)
+		{
+			const FIntPoint chunk(x, y);
+			if (!LoadedChunks.Contains(chunk) && !ChunksInFlight.Contains(chunk) && !GeneratedChunks.Contains(chunk))
+				missingChunks.Add(chunk);
+		}
+	}
+	const FIntPoint playerChunk = PlayerChunk;
+	missingChunks.Sort([playerChunk](const FIntPoint& a, const FIntPoint& b)
+	{
+		return (a - playerChunk).SizeSquared() < (b - playerChunk).SizeSquared();
+	});
+
+	for (int i = 0; i < missingChunks.Num() && NrOfRunningWorkers < MaxChunksInFlight; i++)
+	{
+		GenerateChunkAsync(missingChunks[i]);
+	}
+}
+
+void ADungeonChunkStreamer::GenerateChunkAsync(const FIntPoint& chunk)
+{
+	TSharedPtr<FBSPDungeonGenerator, ESPMode::ThreadSafe> generator = MakeShared<FBSPDungeonGenerator, ESPMode::ThreadSafe>(FDungeonChunkLayout::GetChunkSettings(GetGeneratorSettings(), chunk));
+	ChunksInFlight.Add(chunk, generator);
+	NrOfRunningWorkers++;
+
+	//The worker keeps its own reference to the generator, only the meshes go back to the game thread
+	TWeakObjectPtr<ADungeonChunkStreamer> weakThis = this;
+	const uint32 streamingID = StreamingID;
+	AsyncTask(ENamedThreads::AnyBackgroundThreadNormalTask, [generator, weakThis, streamingID, chunk]()
+	{
+		FDungeonMeshInstances meshes{};
+		const bool isCompleted = generator->GenerateDungeon();
+		if (isCompleted)
+			generator->GetMeshInstances(FTransform::Identity, meshes);
+		UE_LOG(LogDungeonGeneration, Verbose, TEXT("Chunk (%d, %d): %s"), chunk.X, chunk.Y, *generator->GetReport().ToJson());
+
+		AsyncTask(ENamedThreads::GameThread, [weakThis, streamingID, chunk, generator, isCompleted, meshes = MoveTemp(meshes)]() mutable
+		{
+			ADungeonChunkStreamer* streamer = weakThis.Get();
+			if (streamer == nullptr)
+				return;
+
+			//a cancelled worker also ran until now, it is only counted as done here
+			streamer->NrOfRunningWorkers--;
+			if (streamer->StreamingID == streamingID)
+				streamer->FinishChunk(chunk, generator.Get(), isCompleted, meshes);
+		});
+	});
+}
+
+void ADungeonChunkStreamer::FinishChunk(const FIntPoint& chunk, const FBSPDungeonGenerator* generator, bool isCompleted, FDungeonMeshInstances& meshes)
+{
+	//a chunk that was released and requested again has a new generator, the result of the old one is ignored
+	if (ChunksInFlight.FindRef(chunk).Get() != generator)
+		return;
+
+	ChunksInFlight.Remove(chunk);
+	if (isCompleted)
+		GeneratedChunks.Add(chunk, MoveTemp(meshes));
+}
+
+void ADungeonChunkStreamer::SpawnGeneratedChunks()
+{
+	if (GeneratedChunks.Num() == 0)
+		return;
+
+	TArray<FIntPoint> chunksToSpawn{};
+	GeneratedChunks.GetKeys(chunksToSpawn);
+	const FIntPoint playerChunk = PlayerChunk;
+	chunksToSpawn.Sort([playerChunk](const FIntPoint& a, const FIntPoint& b)
+	{
+		return (a - playerChunk).SizeSquared() < (b - playerChunk).SizeSquared();
+	});
+
+	for (int i = 0; i < chunksToSpawn.Num() && i < MaxChunksSpawnedPerFrame; i++)
+	{
+		FDungeonMeshInstances meshes = GeneratedChunks.FindAndRemoveChecked(chunksToSpawn[i]);
+		SpawnChunk(chunksToSpawn[i], meshes);
+	}
+}
+
+void ADungeonChunkStreamer::SpawnChunk(const FIntPoint& chunk, const FDungeonMeshInstances& meshes)
+{
+	SCOPE_CYCLE_COUNTER(STAT_StreamerSpawnChunk);
+
+	FDungeonStreamedChunk streamedChunk{};
+	if (ChunkPool.Num() > 0)
+	{
+		streamedChunk = ChunkPool.Pop(false);
+	}
+	else
+	{
+		streamedChunk.FloorHISMC = CreateChunkComponent(FloorTileISMC);
+		streamedChunk.WallHISMC = CreateChunkComponent(WallTileISMC);
+	}
+
+	//the meshes are relative to the chunk, so the components are moved to the origin of the chunk
+	const FVector chunkOrigin = FDungeonChunkLayout::GetChunkOrigin(chunk, DungeonSize);
+	streamedChunk.FloorHISMC->SetRelativeLocation(chunkOrigin);
+	streamedChunk.WallHISMC->SetRelativeLocation(chunkOrigin);
+	FDungeonInstancedMeshes::AddInstances(streamedChunk.FloorHISMC, meshes.FloorTransforms, meshes.FloorCustomData, false);
+	FDungeonInstancedMeshes::AddInstances(streamedChunk.WallHISMC, meshes.WallTransforms, meshes.WallCustomData, false);
+	LoadedChunks.Add(chunk, streamedChunk);
+}
+
+void ADungeonChunkStreamer::ReleaseChunk(const FIntPoint& chunk)
+{
+	FDungeonStreamedChunk streamedChunk{};
+	if (!LoadedChunks.RemoveAndCopyValue(chunk, streamedChunk))
+		return;
+
+	streamedChunk.FloorHISMC->ClearInstances();
+	streamedChunk.WallHISMC->ClearInstances();
+	ChunkPool.Add(streamedChunk);
+}
+
+void ADungeonChunkStreamer::ReleaseAllChunks()
+{
+	StreamingID++;
+	for (auto& elem : ChunksInFlight)
+	{
+		elem.Value->Cancel();
+	}
+	ChunksInFlight.Empty();
+	GeneratedChunks.Empty();
+
+	TArray<FIntPoint> loadedChunks{};
+	LoadedChunks.GetKeys(loadedChunks);
+	for (const FIntPoint& chunk : loadedChunks)
+	{
+		ReleaseChunk(chunk);
+	}
+}
+
+UHierarchicalInstancedStaticMeshComponent* ADungeonChunkStreamer::CreateChunkComponent(UInstancedStaticMeshComponent* templateISMC)
+{
+	//Movable instead of the mobility of the template, a pooled component is moved to the next chunk that is loaded
+	UHierarchicalInstancedStaticMeshComponent* hismc = NewObject<UHierarchicalInstancedStaticMeshComponent>(this);
+	hismc->SetMobility(EComponentMobility::Movable);
+	hismc->SetStaticMesh(templateISMC->GetStaticMesh());
+	for (int i = 0; i < templateISMC->GetNumMaterials(); i++)
+	{
+		hismc->SetMaterial(i, templateISMC->GetMaterial(i));
+	}
+	hismc->NumCustomDataFloats = templateISMC->NumCustomDataFloats;
+	hismc->SetCollisionProfileName(templateISMC->GetCollisionProfileName());
+	hismc->SetCastShadow(templateISMC->CastShadow);
+	hismc->SetCullDistances(templateISMC->InstanceStartCullDistance, templateISMC->InstanceEndCullDistance);
+	hismc->SetupAttachment(RootComponent);
+	hismc->RegisterComponent();
+	return hismc;
+}
+
+// Called every frame
+void ADungeonChunkStreamer::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	if (!IsStreaming)
+		return;
+
+	PlayerChunk = GetPlayerChunk();
+	ReleaseFarChunks();
+	RequestChunks();
+	SpawnGeneratedChunks();
+
+	SET_DWORD_STAT(STAT_StreamerLoadedChunks, LoadedChunks.Num());
+	SET_DWORD_STAT(STAT_StreamerChunksInFlight, NrOfRunningWorkers);
+}
@@ -0,0 +1,117 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "DungeonInstancedMeshes.h"
+#include "Components/InstancedStaticMeshComponent.h"
+#include "Components/HierarchicalInstancedStaticMeshComponent.h"
+
+void FDungeonInstancedMeshes::AddInstances(UInstancedStaticMeshComponent* ismc, const TArray<FTransform>& transforms, const TArray<float>& customData, bool isWorldSpace)
+{
+	if (ismc == nullptr || transforms.Num() == 0)
+		return;
+
+	const int firstInstanceIndex = ismc->GetInstanceCount();
+	if (isWorldSpace) {
+		//AddInstances expects transforms relative to the component
+		const FTransform& componentTransform = ismc->GetComponentTransform();
+		TArray<FTransform> localTransforms{};
+		localTransforms.Reserve(transforms.Num());
+		for (auto& transform : transforms)
+		{
+			localTransforms.Add(transform.GetRelativeTransform(componentTransform));
+		}
+		ismc->AddInstances(localTransforms, false);
+	}
+	else {
+		ismc->AddInstances(transforms, false);
+	}
+
+	if (customData.Num() != transforms.Num() || ismc->NumCustomDataFloats == 0)
+		return;
+
+	for (int i = 0; i < customData.Num(); i++)
+	{
+		ismc->SetCustomDataValue(firstInstanceIndex + i, 0, customData[i], false);
+	}
+	ismc->MarkRenderStateDirty();
+}
+
+void FDungeonMeshChunks::Reset()
+{
+	for (auto* hismc : Components)
+	{
+		if (IsValid(hismc))
+			hismc->DestroyComponent();
+	}
+	Components.Empty();
+	ChunkIndices.Empty();
+}
+
+void FDungeonMeshChunks::ClearInstances(const TSet<FIntPoint>& chunks)
+{
+	for (const FIntPoint& chunk : chunks)
+	{
+		if (const int* chunkIndex = ChunkIndices.Find(chunk))
+			Components[*chunkIndex]->ClearInstances();
+	}
+}
+
+void FDungeonMeshChunks::AddInstances(UInstancedStaticMeshComponent* templateISMC, const TArray<FTransform>& transforms, const TArray<float>& customData, bool isWorldSpace, float chunkSize)
+{
+	if (templateISMC == nullptr || transforms.Num() == 0)
+		return;
+
+	//Bucket the instances per chunk, every chunk gets one bulk add
+	const bool hasCustomData = customData.Num() == transforms.Num();
+	TMap<FIntPoint, TArray<int>> instancesPerChunk{};
+	for (int i = 0; i < transforms.Num(); i++)
+	{
+		instancesPerChunk.FindOrAdd(GetChunk(transforms[i].GetLocation(), chunkSize)).Add(i);
+	}
+
+	TArray<FTransform> chunkTransforms{};
+	TArray<float> chunkCustomData{};
+	for (auto& elem : instancesPerChunk)
+	{
+		chunkTransforms.Reset(elem.Value.Num());
+		chunkCustomData.Reset(hasCustomData ? elem.Value.Num() : 0);
+		for (int instanceIndex : elem.Value)
+		{
+			chunkTransforms.Add(transforms[instanceIndex]);
+			if (hasCustomData)
+				chunkCustomData.Add(customData[instanceIndex]);
+		}
+
+		UHierarchicalInstancedStaticMeshComponent* hismc = GetOrCreateChunkComponent(templateISMC, elem.Key);
+		FDungeonInstancedMeshes::AddInstances(hismc, chunkTransforms, chunkCustomData, isWorldSpace);
+	}
+}
+
+FIntPoint FDungeonMeshChunks::GetChunk(const FVector& location, float chunkSize)
+{
+	return FIntPoint(FMath::FloorToInt(location.X / chunkSize), FMath::FloorToInt(location.Y / chunkSize));
+}
+
+UHierarchicalInstancedStaticMeshComponent* FDungeonMeshChunks::GetOrCreateChunkComponent(UInstancedStaticMeshComponent* templateISMC, const FIntPoint& chunk)
+{
+	if (const int* chunkIndex = ChunkIndices.Find(chunk))
+		return Components[*chunkIndex];
+
+	//Attached to the template without offset, so transforms relative to the template stay valid
+	UHierarchicalInstancedStaticMeshComponent* hismc = NewObject<UHierarchicalInstancedStaticMeshComponent>(templateISMC->GetOwner());
+	hismc->SetMobility(templateISMC->Mobility);
+	hismc->SetStaticMesh(templateISMC->GetStaticMesh());
+	for (int i = 0; i < templateISMC->GetNumMaterials(); i++)
+	{
+		hismc->SetMaterial(i, templateISMC->GetMaterial(i));
+	}
+	hismc->NumCustomDataFloats = templateISMC->NumCustomDataFloats;
+	hismc->SetCollisionProfileName(templateISMC->GetCollisionProfileName());
+	hismc->SetCastShadow(templateISMC->CastShadow);
+	hismc->SetCullDistances(templateISMC->InstanceStartCullDistance, templateISMC->InstanceEndCullDistance);
+	hismc->SetupAttachment(templateISMC);
+	hismc->RegisterComponent();
+
+	ChunkIndices.Add(chunk, Components.Add(hismc));
+	return hismc;
+}
@@ -8,7 +8,7 @@ public class ProceduralGenDungeon : ModuleRules
 	{
 		PCHUsage = PCHUsageMode.UseExplicitOrSharedPCHs;
 	
-		PublicDependencyModuleNames.AddRange(new string[] { "Core", "CoreUObject", "Engine", "InputCore" });
+		PublicDependencyModuleNames.AddRange(new string[] { "Core", "CoreUObject", "Engine", "InputCore", "DungeonGenerationCore" });
 
 		PrivateDependencyModuleNames.AddRange(new string[] {  });
 
@@ -0,0 +1,121 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Actor.h"
+#include "BSPDungeonGenerator.h"
+#include "DungeonGenerationTypes.h"
+#include "DungeonChunkStreamer.generated.h"
+
+class UInstancedStaticMeshComponent;
+class UHierarchicalInstancedStaticMeshComponent;
+
+/*The floor and wall components of 1 streamed chunk, placed at the origin of the chunk.
+Released chunks keep their components in a pool, so streaming does not create a component per chunk that was ever loaded.*/
+USTRUCT()
+struct PROCEDURALGENDUNGEON_API FDungeonStreamedChunk
+{
+	GENERATED_BODY()
+
+	UPROPERTY(Transient)
+		UHierarchicalInstancedStaticMeshComponent* FloorHISMC = nullptr;
+	UPROPERTY(Transient)
+		UHierarchicalInstancedStaticMeshComponent* WallHISMC = nullptr;
+};
+
+/*Endless BSP dungeon around the player, split into chunks of DungeonSize that are generated on worker threads when the player comes close
+and released when the player moves away. Every chunk only depends on the seed and its chunk coordinate, see FDungeonChunkLayout.*/
+UCLASS()
+class PROCEDURALGENDUNGEON_API ADungeonChunkStreamer : public AActor
+{
+	GENERATED_BODY()
+
+public:
+	// Sets default values for this actor's properties
+	ADungeonChunkStreamer();
+
+	/*Releases all chunks and streams the dungeon of the new seed around the player.*/
+	UFUNCTION(BlueprintCallable, Category = "Dungeon")
+		void RestartStreaming(int seed);
+
+	UFUNCTION(BlueprintPure, Category = "Dungeon")
+		int GetNrOfLoadedChunks() const { return LoadedChunks.Num(); }
+
+	/*The size of 1 chunk, should be divisible by the tilesize.*/
+	UPROPERTY(BlueprintReadOnly, EditAnywhere, Category = "Dungeon")
+		int DungeonSize = 12000;
+	/*The number of times the space of a chunk will be split up randomly.*/
+	UPROPERTY(BlueprintReadOnly, EditAnywhere, Category = "Dungeon")
+		int SplitIterations = 3;
+	/*The size of 1 tile. Must be the same size as the tile meshes (floors, ceilings and walls)*/
+	UPROPERTY(BlueprintReadOnly, EditAnywhere, Category = "Dungeon")
+		int TileSize = 600;
+	/*The minimum amount of tiles, a room requires (used for width and height).*/
+	UPROPERTY(BlueprintReadOnly, EditAnywhere, Category = "Dungeon")
+		int MinTilesPerRoom = 2;
+	/*The ratio of the room (0-1), used to make the rooms look normal and not long rectangles.*/
+	UPROPERTY(BlueprintReadOnly, EditAnywhere, Category = "Dungeon")
+		float MinRoomRatio = 0.4f;
+	UPROPERTY(BlueprintReadOnly, EditAnywhere, Category = "Dungeon")
+		int WallTileWidth = 10;
+	/*The seed of the world, the same seed and settings always generate the same chunks.*/
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "Dungeon")
+		int Seed = 0;
+	/*Pick a new random seed at begin play, the seed that was used is stored in Seed.*/
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "Dungeon")
+		bool IsUsingRandomSeed = true;
+	/*The chunks within this many chunks of the chunk of the player are loaded.*/
+	UPROPERTY(BlueprintReadOnly, EditAnywhere, Category = "Streaming", meta = (ClampMin = "0"))
+		int LoadRadius = 1;
+	/*Loaded chunks further than this many chunks from the chunk of the player are released.
+	Larger than LoadRadius, so walking back and forth over a chunk border does not generate the same chunks again.*/
+	UPROPERTY(BlueprintReadOnly, EditAnywhere, Category = "Streaming", meta = (ClampMin = "1"))
+		int UnloadRadius = 2;
+	/*The maximum number of chunks that are generated on worker threads at the same time, a released chunk counts until its worker stopped.*/
+	UPROPERTY(BlueprintReadOnly, EditAnywhere, Category = "Streaming", meta = (ClampMin = "1"))
+		int MaxChunksInFlight = 4;
+	/*The maximum number of generated chunks that get their meshes per frame, the closest chunks are first.*/
+	UPROPERTY(BlueprintReadOnly, EditAnywhere, Category = "Streaming", meta = (ClampMin = "1"))
+		int MaxChunksSpawnedPerFrame = 1;
+
+protected:
+	// Called when the game starts or when spawned
+	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+	/*The chunk components copy the mesh, materials, collision and cull distances of FloorTileISMC and WallTileISMC.*/
+	UPROPERTY(VisibleAnywhere, Category = "Meshes")
+		UInstancedStaticMeshComponent* FloorTileISMC;
+	UPROPERTY(VisibleAnywhere, Category = "Meshes")
+		UInstancedStaticMeshComponent* WallTileISMC;
+	UPROPERTY(Transient)
+		TMap<FIntPoint, FDungeonStreamedChunk> LoadedChunks;
+	UPROPERTY(Transient)
+		TArray<FDungeonStreamedChunk> ChunkPool;
+
+private:
+	TMap<FIntPoint, TSharedPtr<FBSPDungeonGenerator, ESPMode::ThreadSafe>> ChunksInFlight = {}; //shared with the worker thread of the chunk
+	TMap<FIntPoint, FDungeonMeshInstances> GeneratedChunks = {}; //generated chunks that wait for their meshes
+	int NrOfRunningWorkers = 0; //the workers that did not report back yet, including the ones of cancelled chunks
+	FIntPoint PlayerChunk = FIntPoint::ZeroValue;
+	bool IsStreaming = false;
+	uint32 StreamingID = 0; //results of chunks requested before the last restart are ignored
+
+	FBSPDungeonSettings GetGeneratorSettings() const;
+	FIntPoint GetPlayerChunk() const;
+	bool IsInRadius(const FIntPoint& chunk, int radius) const;
+	void ReleaseFarChunks();
+	void RequestChunks();
+	void GenerateChunkAsync(const FIntPoint& chunk);
+	void FinishChunk(const FIntPoint& chunk, const FBSPDungeonGenerator* generator, bool isCompleted, FDungeonMeshInstances& meshes);
+	void SpawnGeneratedChunks();
+	void SpawnChunk(const FIntPoint& chunk, const FDungeonMeshInstances& meshes);
+	void ReleaseChunk(const FIntPoint& chunk);
+	void ReleaseAllChunks();
+	UHierarchicalInstancedStaticMeshComponent* CreateChunkComponent(UInstancedStaticMeshComponent* templateISMC);
+
+public:
+	// Called every frame
+	virtual void Tick(float DeltaTime) override;
+
+};
@@ -0,0 +1,151 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Async/Async.h"
+#include "DungeonGenerationTypes.h"
+#include "DungeonLayoutCache.h"
+
+/*What a generation of 1 dungeon actor runs, on the game thread or on a worker thread.
+The actor fills in the parts that depend on the generator type, Run is the same for every dungeon.*/
+template<typename GeneratorType>
+struct TDungeonGenerationJob
+{
+	TSharedPtr<GeneratorType, ESPMode::ThreadSafe> Generator = nullptr;
+	TFunction<void(const GeneratorType&, FDungeonMeshInstances&)> GetMeshInstances = nullptr;
+	bool IsUsingLayoutCache = false;
+	FSHAHash CacheKey = {};
+	const TCHAR* CacheReportName = TEXT("Cache");
+
+	void Run(FDungeonGenerationResult& outResult) const
+	{
+		//a dungeon from the cache goes straight to spawning the meshes
+		if (IsUsingLayoutCache)
+		{
+			outResult.Report.Reset(CacheReportName, Generator->GetSettings().Seed);
+			{
+				FDungeonGenerationPhaseScope phaseScope(outResult.Report, TEXT("CacheLookup"));
+				outResult.IsFromCache = FDungeonLayoutCache::Get().Find(CacheKey, outResult.Meshes);
+			}
+			if (outResult.IsFromCache)
+			{
+				outResult.IsCompleted = true;
+				FDungeonLayoutCache::Get().AddCounters(outResult.Report);
+				return;
+			}
+		}
+
+		outResult.IsCompleted = Generator->GenerateDungeon();
+		outResult.Report = Generator->GetReport();
+
+		//floors and walls of every tile
+		if (outResult.IsCompleted)
+		{
+			FDungeonGenerationPhaseScope phaseScope(outResult.Report, TEXT("GetMeshInstances"));
+			GetMeshInstances(*Generator, outResult.Meshes);
+		}
+		if (IsUsingLayoutCache && outResult.IsCompleted)
+			FDungeonLayoutCache::Get().Add(CacheKey, outResult.Meshes);
+	}
+};
+
+/*The state of the generations of 1 dungeon actor: start, run on the game thread or a worker thread, cancel and finish.
+The actor owns it as a member and only spawns the meshes between BeginSpawning and EndSpawning.*/
+template<typename GeneratorType>
+class TDungeonGenerationTask
+{
+public:
+	EDungeonGenerationState GetState() const { return State; }
+	bool IsIdle() const { return State == EDungeonGenerationState::IDLE; }
+
+	/*Results of older generations are ignored from now on.*/
+	void Start(const TDungeonGenerationJob<GeneratorType>& job)
+	{
+		State = EDungeonGenerationState::GENERATING;
+		GenerationID++;
+		Job = job;
+	}
+
+	void Run(FDungeonGenerationResult& outResult) const
+	{
+		Job.Run(outResult);
+	}
+
+	/*Runs the job on a worker thread, onFinish is called on the game thread unless the owner was destroyed or a newer generation started.*/
+	void RunAsync(const UObject* owner, const FOnDungeonGenerated& onComplete, TFunction<void(FDungeonGenerationResult&)> onFinish)
+	{
+		OnGenerationComplete = onComplete;
+
+		//The worker keeps its own copy of the job, the actor can reset or be destroyed in the meantime
+		const TDungeonGenerationJob<GeneratorType> job = Job;
+		TWeakObjectPtr<const UObject> weakOwner = owner;
+		TDungeonGenerationTask* task = this;
+		const uint32 generationID = GenerationID;
+		AsyncTask(ENamedThreads::AnyBackgroundThreadNormalTask, [job, weakOwner, task, generationID, onFinish = MoveTemp(onFinish)]() mutable
+		{
+			FDungeonGenerationResult result{};
+			job.Run(result);
+
+			//the task is a member of the owner, so it is alive as long as the owner is
+			AsyncTask(ENamedThreads::GameThread, [weakOwner, task, generationID, onFinish = MoveTemp(onFinish), result = MoveTemp(result)]() mutable
+			{
+				if (weakOwner.IsValid() && task->GenerationID == generationID)
+					onFinish(result);
+			});
+		});
+	}
+
+	void Cancel()
+	{
+		if (State == EDungeonGenerationState::GENERATING)
+		{
+			State = EDungeonGenerationState::CANCELLING;
+			Job.Generator->Cancel();
+		}
+	}
+
+	/*Cancels and ignores the result of a generation that is still running, for when the owner ends play.*/
+	void Abandon()
+	{
+		Cancel();
+		GenerationID++;
+		State = EDungeonGenerationState::IDLE;
+		OnGenerationComplete.Unbind();
+		Job = {};
+	}
+
+	/*Returns false when the generation was cancelled or did not complete, the task is idle again and the delegate got false.
+	A generation that was cancelled is not spawned, even when the generator finished before it saw the cancel.*/
+	bool BeginSpawning(const FDungeonGenerationResult& result)
+	{
+		Job = {};
+		if (State == EDungeonGenerationState::CANCELLING || !result.IsCompleted)
+		{
+			CompleteGeneration(false);
+			return false;
+		}
+		State = EDungeonGenerationState::SPAWNING;
+		return true;
+	}
+
+	void EndSpawning()
+	{
+		CompleteGeneration(true);
+	}
+
+private:
+	EDungeonGenerationState State = EDungeonGenerationState::IDLE;
+	uint32 GenerationID = 0; //results of older generations are ignored
+	FOnDungeonGenerated OnGenerationComplete;
+	TDungeonGenerationJob<GeneratorType> Job = {}; //only set while generating
+
+	void CompleteGeneration(bool isCompleted)
+	{
+		//The delegate can start the next generation, so it is called after the task is idle again
+		FOnDungeonGenerated onComplete = OnGenerationComplete;
+		OnGenerationComplete.Unbind();
+		State = EDungeonGenerationState::IDLE;
+		onComplete.ExecuteIfBound(isCompleted);
+	}
+};
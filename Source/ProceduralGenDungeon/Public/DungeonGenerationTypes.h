@@ -0,0 +1,28 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "DungeonGenerationReport.h"
+#include "DungeonMeshInstances.h"
+#include "DungeonGenerationTypes.generated.h"
+
+UENUM(BlueprintType)
+enum class EDungeonGenerationState : uint8 {
+	IDLE = 0 UMETA(DisplayName = "Idle"),
+	GENERATING = 1 UMETA(DisplayName = "Generating"),
+	CANCELLING = 2 UMETA(DisplayName = "Cancelling"),
+	SPAWNING = 3 UMETA(DisplayName = "Spawning"),
+};
+
+/*Called on the game thread when an async generation is done, IsCompleted is false when it was cancelled.*/
+DECLARE_DYNAMIC_DELEGATE_OneParam(FOnDungeonGenerated, bool, IsCompleted);
+
+/*Everything the worker thread hands back to the game thread after generating a dungeon.*/
+struct FDungeonGenerationResult
+{
+	bool IsCompleted = false;
+	bool IsFromCache = false; //the meshes come from FDungeonLayoutCache, no dungeon was generated
+	FDungeonMeshInstances Meshes = {};
+	FDungeonGenerationReport Report = {};
+};
@@ -0,0 +1,40 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "DungeonInstancedMeshes.generated.h"
+
+class UInstancedStaticMeshComponent;
+class UHierarchicalInstancedStaticMeshComponent;
+
+struct PROCEDURALGENDUNGEON_API FDungeonInstancedMeshes
+{
+	/*Adds all transforms to the component with one bulk add. The custom data holds one value (custom data index 0) per transform or is empty,
+	it is written without touching the render state, which is marked dirty once at the end.*/
+	static void AddInstances(UInstancedStaticMeshComponent* ismc, const TArray<FTransform>& transforms, const TArray<float>& customData, bool isWorldSpace);
+};
+
+/*Splits the instances of one mesh over square chunks, every chunk is its own hierarchical instanced static mesh component
+so it can be culled and LODed on its own. The chunk components copy the mesh, materials, collision and cull distances of a template component.*/
+USTRUCT()
+struct PROCEDURALGENDUNGEON_API FDungeonMeshChunks
+{
+	GENERATED_BODY()
+
+	UPROPERTY(Transient)
+		TArray<UHierarchicalInstancedStaticMeshComponent*> Components;
+	TMap<FIntPoint, int> ChunkIndices; //chunk coordinate, index in Components
+
+	/*Destroys all chunk components.*/
+	void Reset();
+	/*Removes the instances of the given chunks, the chunk components stay.*/
+	void ClearInstances(const TSet<FIntPoint>& chunks);
+	/*The transforms are relative to the template component, or world space when isWorldSpace is set.*/
+	void AddInstances(UInstancedStaticMeshComponent* templateISMC, const TArray<FTransform>& transforms, const TArray<float>& customData, bool isWorldSpace, float chunkSize);
+	int Num() const { return Components.Num(); }
+	static FIntPoint GetChunk(const FVector& location, float chunkSize);
+
+private:
+	UHierarchicalInstancedStaticMeshComponent* GetOrCreateChunkComponent(UInstancedStaticMeshComponent* templateISMC, const FIntPoint& chunk);
+};
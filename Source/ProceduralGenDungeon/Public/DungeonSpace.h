@@ -4,135 +4,12 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/Actor.h"
+#include "BSPDungeonGenerator.h"
+#include "DungeonGenerationTypes.h"
+#include "DungeonGenerationTask.h"
+#include "DungeonInstancedMeshes.h"
 #include "DungeonSpace.generated.h"
 
-UENUM(BlueprintType)
-enum class ESeperation : uint8 {
-	VERTICAL = 0 UMETA(DisplayName = "Vertical"),
-	HORIZONTAL = 1  UMETA(DisplayName = "Horizontal"),
-};
-
-UENUM(BlueprintType)
-enum class ETileType : uint8 {
-	EMPTY = 0 UMETA(DisplayName = "Empty"),
-	ROOM = 1 UMETA(DisplayName = "Room"),
-	CORRIDOR = 2  UMETA(DisplayName = "Corridor"),
-};
-
-UENUM(BlueprintType)
-enum class EDungeonObjectType : uint8 {
-	FLOOR = 0 UMETA(DisplayName = "Floor"),
-	WALL = 1  UMETA(DisplayName = "Wall"),
-	CEILING = 2  UMETA(DisplayName = "Ceiling"),
-	PILLAR = 3  UMETA(DisplayName = "Pillar"),
-	TORCH = 4  UMETA(DisplayName = "Torch"),
-};
-
-UENUM(BlueprintType)
-enum class EDungeonObjectAlign : uint8 {
-	LEFT = 0 UMETA(DisplayName = "Left"),
-	RIGHT = 1  UMETA(DisplayName = "Right"),
-	TOP = 2  UMETA(DisplayName = "Top"),
-	BOTTOM = 3  UMETA(DisplayName = "Bottom"),
-	CENTER = 4  UMETA(DisplayName = "Center"),
-};
-
-USTRUCT()
-struct FDungeonObject
-{
-	GENERATED_BODY()
-		EDungeonObjectType objectType;
-	FVector rotation;
-	EDungeonObjectAlign objectAlignement;
-
-	FDungeonObject()
-		:objectType(EDungeonObjectType::FLOOR)
-		, rotation(1, 0, 0)
-		, objectAlignement(EDungeonObjectAlign::CENTER)
-	{
-
-	}
-
-	FDungeonObject(EDungeonObjectType type, EDungeonObjectAlign align, FVector rot)
-		:objectType(type)
-		, rotation(rot)
-		, objectAlignement(align)
-	{
-
-	}
-};
-
-USTRUCT()
-struct FTile
-{
-	GENERATED_BODY()
-		int left;
-	int bottom;
-	TArray<FDungeonObject> objectsToSpawn;
-	ETileType tileType;
-	int corridorID;
-	int miniMapTileInstanceID;
-
-	FTile()
-		:left(0),
-		bottom(0),
-		tileType(ETileType::EMPTY),
-		corridorID(-1),
-		miniMapTileInstanceID(0)
-	{
-
-	}
-
-	FTile(int tileLeft, int tileBottom, ETileType tileTypex, int corridorIDx = -1)
-		:left(tileLeft),
-		bottom(tileBottom),
-		tileType(tileTypex),
-		corridorID(corridorIDx)
-	{
-
-	}
-};
-
-USTRUCT()
-struct FCorridor
-{
-	GENERATED_BODY()
-		FIntVector start;
-	FIntVector end;
-	ESeperation seperation;
-};
-
-USTRUCT()
-struct FData
-{
-	GENERATED_BODY()
-		int key;
-	int width;
-	int height;
-	int left;
-	int bottom;
-	ESeperation seperation;
-	int tilesSeperated;
-
-};
-
-USTRUCT()
-struct FSpace
-{
-	GENERATED_BODY()
-	FData data;
-	FSpace* left;
-	FSpace* right;
-
-	FSpace()
-		:data()
-		, left(nullptr)
-		, right(nullptr)
-	{
-
-	}
-};
-
 UCLASS()
 class PROCEDURALGENDUNGEON_API ADungeonSpace : public AActor
 {
@@ -145,6 +22,27 @@ public:
 	void DebugTiles(FVector& tilePos);
 	void GenerateDungeon();
 
+	/*Generates the dungeon with the given seed on a worker thread, only the meshes are added on the game thread.
+	Returns false when the previous generation is not done yet.*/
+	UFUNCTION(BlueprintCallable, Category = "Dungeon")
+		bool GenerateDungeonAsync(int seed, const FOnDungeonGenerated& onComplete);
+
+	/*Stops the running async generation, OnComplete is called with IsCompleted false.*/
+	UFUNCTION(BlueprintCallable, Category = "Dungeon")
+		void CancelGeneration();
+
+	UFUNCTION(BlueprintPure, Category = "Dungeon")
+		EDungeonGenerationState GetGenerationState() const { return Generation.GetState(); }
+
+	/*Writes the layout of the generated dungeon to Saved/DungeonGeneration/fileName, see FDungeonLayoutFile.*/
+	UFUNCTION(BlueprintCallable, Category = "Dungeon")
+		bool SaveLayout(const FString& fileName) const;
+
+	/*Replaces the dungeon with the layout in Saved/DungeonGeneration/fileName, the meshes are built straight from the mapped file.
+	Returns false when the file is not a valid layout or its tilesize differs from TileSize.*/
+	UFUNCTION(BlueprintCallable, Category = "Dungeon")
+		bool LoadLayout(const FString& fileName);
+
 	/*The size of the dungeon should be divisible by the tilesize.*/
 	UPROPERTY(BlueprintReadOnly, EditAnywhere, Category = "Dungeon")
 		int DungeonSize = 36000;
@@ -162,6 +60,36 @@ public:
 		float MinRoomRatio = 0.4f;
 	UPROPERTY(BlueprintReadOnly, EditAnywhere, Category = "Dungeon")
 		int WallTileWidth = 10;
+	/*The spaces above this depth of the tree split their two subtrees on worker threads, 0 splits the whole tree on one thread.
+	Every space has its own random stream, so the dungeon is the same for any depth.*/
+	UPROPERTY(BlueprintReadOnly, EditAnywhere, Category = "Dungeon", meta = (ClampMin = "0"))
+		int ParallelSplitDepth = 0;
+	/*The seed of the dungeon, the same seed and settings always generate the same dungeon.*/
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "Dungeon")
+		int Seed = 0;
+	/*Pick a new random seed every generation, the seed that was used is stored in Seed.*/
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "Dungeon")
+		bool IsUsingRandomSeed = true;
+	/*Split the floors and walls over hierarchical instanced mesh components per chunk, so far away chunks are culled and LODed.
+	The chunks copy the mesh, materials, collision and cull distances of FloorTileISMC and WallTileISMC.*/
+	UPROPERTY(BlueprintReadOnly, EditAnywhere, Category = "Dungeon")
+		bool IsUsingMeshChunks = false;
+	/*The width and height of a mesh chunk in tiles.*/
+	UPROPERTY(BlueprintReadOnly, EditAnywhere, Category = "Dungeon", meta = (ClampMin = "1", EditCondition = "IsUsingMeshChunks"))
+		int MeshChunkTiles = 16;
+	/*Look the dungeon up in FDungeonLayoutCache before generating it, a dungeon in the cache skips every generation phase.
+	A dungeon from the cache has no tiles, so the minimap, the debug tiles and SaveLayout are not available for it.*/
+	UPROPERTY(BlueprintReadOnly, EditAnywhere, Category = "Dungeon")
+		bool IsUsingLayoutCache = false;
+	/*The size limits of the memory and disk tier of the layout cache, the cache is shared by all dungeons.*/
+	UPROPERTY(BlueprintReadOnly, EditAnywhere, Category = "Dungeon", meta = (ClampMin = "0", EditCondition = "IsUsingLayoutCache"))
+		int LayoutCacheMemoryMB = 256;
+	UPROPERTY(BlueprintReadOnly, EditAnywhere, Category = "Dungeon", meta = (ClampMin = "0", EditCondition = "IsUsingLayoutCache"))
+		int LayoutCacheDiskMB = 1024;
+	/*Append the phase timings and counters of every generation to Saved/DungeonGeneration/BSPDungeonReport.csv,
+	the dungeons from the layout cache go to BSPDungeonCacheReport.csv.*/
+	UPROPERTY(BlueprintReadOnly, EditAnywhere, Category = "Dungeon")
+		bool IsWritingGenerationReport = false;
 	UPROPERTY(BlueprintReadOnly, EditAnywhere, Category = "Minimap")
 		int CubeMeshSize = 100;
 	UPROPERTY(BlueprintReadOnly, EditAnywhere, Category = "Minimap")
@@ -175,36 +103,33 @@ public:
 protected:
 	// Called when the game starts or when spawned
 	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 	UPROPERTY(VisibleAnywhere, Category = "Meshes")
 		UInstancedStaticMeshComponent* CubeISMC;
 	UPROPERTY(VisibleAnywhere, Category = "Meshes")
 		UInstancedStaticMeshComponent* FloorTileISMC;
 	UPROPERTY(VisibleAnywhere, Category = "Meshes")
 		UInstancedStaticMeshComponent* WallTileISMC;
+	UPROPERTY(Transient)
+		FDungeonMeshChunks FloorTileChunks;
+	UPROPERTY(Transient)
+		FDungeonMeshChunks WallTileChunks;
 
 
 private:
-	FSpace* RootSpace;
-	TArray<FSpace*> DungeonRooms;
-	TMap<int, FCorridor*> DungeonCorridors; //first space id, second corridor
-	TArray<FTile> TileArray;
-	int TileRows;
+	TSharedPtr<FBSPDungeonGenerator, ESPMode::ThreadSafe> Generator = nullptr; //shared with the worker thread during an async generation
+	TArray<int> MinimapTileInstanceIDs = {};
 	bool IsDungeonGenerated;
+	TDungeonGenerationTask<FBSPDungeonGenerator> Generation;
 
-	
-	FSpace* SplitSpace(FSpace* currentSpace, int index, int maxElements, FData parentData);
-	void PrintTree(FString& string, FSpace* root);
-	void SelectDungeonRooms(FSpace* currentSpace, int currentDepth);
-	void FillTileGrid();
-	void ConstructDungeonGrid();
-	void ShrinkSpaceToRoom(FSpace* currentSpace);
-	bool CheckIfWallShouldBePlaced(int tileIndex, int adjacentTileIndex);
-	bool IsCorridorConnected(int tileIndex);
-	void PlaceCorridorsWalls(int tileIndex);
+	FBSPDungeonSettings GetGeneratorSettings() const;
+	void StartGeneration(int seed);
+	void FinishGeneration(FDungeonGenerationResult& result);
+	void SpawnInstancedMeshes(const FDungeonMeshInstances& meshes, FDungeonGenerationReport& report);
 	void ShowDebugTile(int tileIndex, FString& tileInfo, FColor colorBox);
-	void PlaceWalls(int tileIndex);
 	void ResetDungeon();
 	void MoveSpawnPlatform();
+	static FString GetLayoutFilePath(const FString& fileName);
 
 public:
 	// Called every frame
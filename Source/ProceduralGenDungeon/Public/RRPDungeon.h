@@ -4,19 +4,35 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/Actor.h"
+#include "RRPDungeonGenerator.h"
+#include "DungeonGenerationTypes.h"
+#include "DungeonGenerationTask.h"
+#include "DungeonInstancedMeshes.h"
 #include "RRPDungeon.generated.h"
 
 UENUM(BlueprintType)
-enum class ETileNodeType : uint8 {
-	EMPTY = 0 UMETA(DisplayName = "Empty"),
-	ROOM = 1 UMETA(DisplayName = "Room"),
-	CORRIDOR = 2 UMETA(DisplayName = "Corridor"),
-	DOOR = 3 UMETA(DisplayName = "Door"),
+enum class ECorridorType : uint8 {
+	RANDOMROOMCONNECT = 0 UMETA(DisplayName = "Random Room Connect"),
+	MINIMUMSPANNINGTREE = 1 UMETA(DisplayName = "Minimum Spanning Tree"),
 };
 
 UENUM(BlueprintType)
-enum class ECorridorType : uint8 {
-	RANDOMROOMCONNECT = 0 UMETA(DisplayName = "Random Room Connect"),
+enum class ESeperationMode : uint8 {
+	SEQUENTIAL = 0 UMETA(DisplayName = "Sequential"),
+	PARALLEL = 1 UMETA(DisplayName = "Parallel"),
+};
+
+UENUM(BlueprintType)
+enum class EPathfindingMode : uint8 {
+	SEQUENTIAL = 0 UMETA(DisplayName = "Sequential"),
+	PARALLEL = 1 UMETA(DisplayName = "Parallel"),
+};
+
+UENUM(BlueprintType)
+enum class EPathfindingAlgorithm : uint8 {
+	ASTAR = 0 UMETA(DisplayName = "A*"),
+	JUMPPOINTSEARCH = 1 UMETA(DisplayName = "Jump Point Search"),
+	HIERARCHICAL = 2 UMETA(DisplayName = "Hierarchical (HPA*)"),
 };
 
 UENUM(BlueprintType)
@@ -26,117 +42,7 @@ enum class EHeuristicCost : uint8 {
 	SQRTEUCLIDEAN = 2 UMETA(DisplayName = "SqrtEuclidean"),
 	OCTILE = 3 UMETA(DisplayName = "Octile"),
 	CHEBYSHEV = 4 UMETA(DisplayName = "Chebyshev"),
-};
-
-USTRUCT()
-struct FTileConnection
-{
-	GENERATED_BODY()
-
-		int FromNodeID;
-	int ToNodeID;
-	float ConnectionCost;
-
-	FTileConnection(int fromNodeID, int toNodeID, float connectionCost)
-		:FromNodeID(fromNodeID)
-		, ToNodeID(toNodeID)
-		, ConnectionCost(connectionCost)
-	{
-
-	}
-
-	FTileConnection()
-		:FromNodeID(-1)
-		, ToNodeID(-1)
-		, ConnectionCost(0)
-	{
-
-	}
-};
-
-USTRUCT()
-struct FTileNode
-{
-	GENERATED_BODY()
-
-		int NodeID;
-	FVector TilePosition;
-	TArray<FTileConnection> Connections;
-	ETileNodeType TileNodeType;
-
-	FTileNode(int nodeID, FVector tilePosition)
-		:NodeID(nodeID)
-		, TilePosition(tilePosition)
-	{
-		Connections = {};
-		TileNodeType = ETileNodeType::EMPTY;
-	}
-
-	FTileNode()
-		:NodeID(-1)
-		, TilePosition()
-	{
-		Connections = {};
-		TileNodeType = ETileNodeType::EMPTY;
-	}
-
-};
-
-USTRUCT()
-struct FTileNodeRecord
-{
-	GENERATED_BODY()
-
-		FTileNode* TileNode;
-	FTileConnection Connection;
-	float CostSoFar;
-	float EstimatedTotalCost;
-
-	FTileNodeRecord()
-		:TileNode(nullptr)
-		, Connection()
-		, CostSoFar(0.f)
-		, EstimatedTotalCost(0.f)
-	{
-
-	}
-
-	bool operator<(const FTileNodeRecord& other) const
-	{
-		return EstimatedTotalCost < other.EstimatedTotalCost;
-	}
-
-	friend bool operator==(const FTileNodeRecord& lhs, const FTileNodeRecord& rhs)
-	{
-		return lhs.TileNode->NodeID == rhs.TileNode->NodeID
-			&& lhs.Connection.FromNodeID == rhs.Connection.FromNodeID
-			&& lhs.Connection.ToNodeID == rhs.Connection.ToNodeID
-			&& lhs.CostSoFar == rhs.CostSoFar
-			&& lhs.EstimatedTotalCost == rhs.EstimatedTotalCost;
-	}
-};
-
-USTRUCT()
-struct FDoor
-{
-	GENERATED_BODY()
-		UPROPERTY(EditAnywhere, meta = (TitleProperty = "Room ID"))
-		int TileID;
-	UPROPERTY(EditAnywhere, meta = (TitleProperty = "Corridor ID"))
-		float CorridorID;
-	UPROPERTY(EditAnywhere, meta = (TitleProperty = "Door direction"))
-		FVector Direction;
-	UPROPERTY(EditAnywhere, meta = (TitleProperty = "Door direction"))
-		TArray<int32> WallInstancesToRemove;
-
-	FDoor()
-		:TileID(-1)
-		, CorridorID(-1)
-		, Direction()
-	{
-		WallInstancesToRemove = {};
-	}
-
+	ADMISSIBLEMANHATTAN = 5 UMETA(DisplayName = "Admissible Manhattan"),
 };
 
 USTRUCT(BlueprintType)
@@ -151,7 +57,6 @@ struct FRoom
 		float Height;
 	UPROPERTY(EditAnywhere, meta = (TitleProperty = "Room position"))
 		FVector CentralPosition;
-	TArray<FTileNode*> TileNodesOfRoom;
 
 	FRoom()
 		:RoomID(0)
@@ -159,7 +64,7 @@ struct FRoom
 		, Height(0)
 		, CentralPosition(0, 0, 0)
 	{
-		TileNodesOfRoom = {};
+
 	}
 };
 
@@ -175,6 +80,31 @@ public:
 	UFUNCTION(BlueprintCallable, Category = "RRPDungeon")
 		void GenerateDungeon();
 
+	/*Generates the dungeon with the given seed on a worker thread, only the meshes are added on the game thread.
+	Returns false when the previous generation is not done yet.*/
+	UFUNCTION(BlueprintCallable, Category = "RRPDungeon")
+		bool GenerateDungeonAsync(int seed, const FOnDungeonGenerated& onComplete);
+
+	/*Stops the running async generation, OnComplete is called with IsCompleted false.*/
+	UFUNCTION(BlueprintCallable, Category = "RRPDungeon")
+		void CancelGeneration();
+
+	UFUNCTION(BlueprintPure, Category = "RRPDungeon")
+		EDungeonGenerationState GetGenerationState() const { return Generation.GetState(); }
+
+	/*Applies ArrayOfPremadeRooms to the generated dungeon, only the corridors and meshes around the rooms that were added, moved or removed are made again.
+	Generates the whole dungeon with the same seed when there is no dungeon yet or a room does not fit in it.*/
+	UFUNCTION(BlueprintCallable, Category = "RRPDungeon")
+		void UpdatePremadeRooms();
+
+	/*The seed of the dungeon, the same seed and settings always generate the same dungeon.*/
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "RRPDungeon settings")
+		int Seed = 0;
+
+	/*Pick a new random seed every generation, the seed that was used is stored in Seed.*/
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "RRPDungeon settings")
+		bool IsUsingRandomSeed = true;
+
 	/*The middle point of the dungeon.*/
 	UPROPERTY(BlueprintReadOnly, EditAnywhere, Category = "RRPDungeon settings")
 		FVector DungeonCentralPosition = {};
@@ -223,54 +153,109 @@ public:
 	UPROPERTY(BlueprintReadOnly, EditAnywhere, Category = "RRPDungeon settings")
 		EHeuristicCost HeuresticCostFunction = EHeuristicCost::MANHATTAN;
 
+	/*Limits every search to the bounding box of the 2 rooms plus this many TileNodes, the margin doubles until a path is found.
+	0 searches the whole grid (Pathfinding).*/
+	UPROPERTY(BlueprintReadOnly, EditAnywhere, Category = "RRPDungeon settings", meta = (ClampMin = "0"))
+		int SearchWindowMargin = 0;
+
+	/*Sequential searches the corridors one by one, every search sees the corridors before it.
+	Parallel searches batches of corridors on multiple threads and adds them in the same order, corridors that cross an earlier corridor of the batch are searched again (Pathfinding).*/
+	UPROPERTY(BlueprintReadOnly, EditAnywhere, Category = "RRPDungeon settings")
+		EPathfindingMode PathfindingMode = EPathfindingMode::SEQUENTIAL;
+
+	/*Jump Point Search skips the TileNodes in the middle of empty areas with the same connection cost, the corridors, rooms and doors are searched like A* (Pathfinding).*/
+	UPROPERTY(BlueprintReadOnly, EditAnywhere, Category = "RRPDungeon settings")
+		EPathfindingAlgorithm PathfindingAlgorithm = EPathfindingAlgorithm::ASTAR;
+
+	/*The number of TileNodes along each side of a cluster of the hierarchical search. The route is searched between the cluster entrances first
+	and only refined inside the clusters it passes through, a corridor only updates the clusters it crosses (Pathfinding).*/
+	UPROPERTY(BlueprintReadOnly, EditAnywhere, Category = "RRPDungeon settings", meta = (ClampMin = "2", EditCondition = "PathfindingAlgorithm == EPathfindingAlgorithm::HIERARCHICAL"))
+		int ClusterSize = 16;
+
+	/*The maximum number of passes over all rooms to seperate them, stops the seperation if the rooms can't be pulled apart.*/
+	UPROPERTY(BlueprintReadOnly, EditAnywhere, Category = "RRPDungeon settings", meta = (ClampMin = "1"))
+		int MaxSeperationIterations = 1000;
+
+	/*Sequential moves every room as soon as its push is known (order dependent).
+	Parallel calculates all pushes from the previous positions on multiple threads and moves the rooms together.*/
+	UPROPERTY(BlueprintReadOnly, EditAnywhere, Category = "RRPDungeon settings")
+		ESeperationMode SeperationMode = ESeperationMode::SEQUENTIAL;
+
+	/*Random room connect connects every room to the next room in the array.
+	Minimum spanning tree connects the rooms that are close to each other (Delaunay triangulation), with the least amount of corridors.*/
+	UPROPERTY(BlueprintReadOnly, EditAnywhere, Category = "RRPDungeon settings")
+		ECorridorType CorridorType = ECorridorType::RANDOMROOMCONNECT;
+
+	/*The part (0-1) of the connections that are not in the minimum spanning tree that still get a corridor, makes loops in the dungeon.*/
+	UPROPERTY(BlueprintReadOnly, EditAnywhere, Category = "RRPDungeon settings", meta = (ClampMin = "0", ClampMax = "1", EditCondition = "CorridorType == ECorridorType::MINIMUMSPANNINGTREE"))
+		float ExtraConnectionFraction = 0.15f;
+
 	/*Draw debug.*/
 	UPROPERTY(BlueprintReadOnly, EditAnywhere, Category = "RRPDungeon settings")
 		bool IsDrawingDebug = true;
 
+	/*Split the floors and walls over hierarchical instanced mesh components per chunk, so far away chunks are culled and LODed.
+	The chunks copy the mesh, materials, collision and cull distances of FloorTileISMC and WallTileISMC.*/
+	UPROPERTY(BlueprintReadOnly, EditAnywhere, Category = "RRPDungeon settings")
+		bool IsUsingMeshChunks = false;
+
+	/*The width and height of a mesh chunk in tiles.*/
+	UPROPERTY(BlueprintReadOnly, EditAnywhere, Category = "RRPDungeon settings", meta = (ClampMin = "1", EditCondition = "IsUsingMeshChunks"))
+		int MeshChunkTiles = 16;
+
+	/*Call UpdatePremadeRooms when ArrayOfPremadeRooms is edited, instead of generating the whole dungeon again.
+	Only the mesh chunks around the changes are updated, without mesh chunks all instances are added again.*/
+	UPROPERTY(BlueprintReadOnly, EditAnywhere, Category = "RRPDungeon settings")
+		bool IsUpdatingOnPremadeRoomEdit = false;
+
+	/*Look the dungeon up in FDungeonLayoutCache before generating it, a dungeon in the cache skips every generation phase.
+	A dungeon from the cache has no rooms or TileNodes, so it is generated again when a premade room changes and draws no debug tiles.*/
+	UPROPERTY(BlueprintReadOnly, EditAnywhere, Category = "RRPDungeon settings")
+		bool IsUsingLayoutCache = false;
+
+	/*The size limits of the memory and disk tier of the layout cache, the cache is shared by all dungeons.*/
+	UPROPERTY(BlueprintReadOnly, EditAnywhere, Category = "RRPDungeon settings", meta = (ClampMin = "0", EditCondition = "IsUsingLayoutCache"))
+		int LayoutCacheMemoryMB = 256;
+	UPROPERTY(BlueprintReadOnly, EditAnywhere, Category = "RRPDungeon settings", meta = (ClampMin = "0", EditCondition = "IsUsingLayoutCache"))
+		int LayoutCacheDiskMB = 1024;
+
+	/*Append the phase timings and counters of every generation to Saved/DungeonGeneration/RRPDungeonReport.csv,
+	the updates of the premade rooms go to RRPDungeonUpdateReport.csv and the dungeons from the layout cache to RRPDungeonCacheReport.csv.*/
+	UPROPERTY(BlueprintReadOnly, EditAnywhere, Category = "RRPDungeon settings")
+		bool IsWritingGenerationReport = false;
+
 
 
 protected:
 	// Called when the game starts or when spawned
 	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+#if WITH_EDITOR
+	virtual void PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent) override;
+#endif
 
 	UPROPERTY(VisibleAnywhere, Category = "Meshes")
 		UInstancedStaticMeshComponent* FloorTileISMC;
 	UPROPERTY(VisibleAnywhere, Category = "Meshes")
 		UInstancedStaticMeshComponent* WallTileISMC;
+	UPROPERTY(Transient)
+		FDungeonMeshChunks FloorTileChunks;
+	UPROPERTY(Transient)
+		FDungeonMeshChunks WallTileChunks;
 private:
 
-	TMap<int, FTileNode> TileNodeGrid = {};
-	TMap<int, TArray<FTileNode*>> CorridorTiles = {};
-	TArray<FVector> AdjacentDirections = { { 1, 0, 0 }, { 0, 1, 0 }, { -1, 0, 0 }, { 0, -1, 0 } };
-	TMap<int, FDoor> DoorTiles = {};
-	bool IsDungeonGenerating = false;
-	bool HasOverlap = true;
-	float TopOfGrid = FLT_MAX;
-	float BotOfGrid = FLT_MIN;
-	float RightOfGrid = FLT_MIN;
-	float LeftOfGrid = FLT_MAX;
-	int NrOfGridCols = 0;
-	int NrOfGridRows = 0;
-
-
-	void GenerateRooms();
-	void SeperateRooms();
-	void ContructTileNodeGrid();
-	void AttachTileNodesToRooms();
-	void RandomRoomConnect();
-	void CreateCorridorFromPath(TArray<FTileNode*>& path);
-	void CreateDoorTile(FTileNode* currentNode, FTileNode* nextNode, int corridorID);
-	void SpawnInstancedMeshes();
-	void SpawnMeshesOnTileNode(FTileNode* node, FTransform& floorTransform, FTransform& wallTransform, TArray<ETileNodeType>& tilesTypesToIgnore);
+	TSharedPtr<FRRPDungeonGenerator, ESPMode::ThreadSafe> Generator = nullptr; //shared with the worker thread during an async generation
+	TDungeonGenerationTask<FRRPDungeonGenerator> Generation;
+
+	FRRPDungeonSettings GetGeneratorSettings() const;
+	void StartGeneration(int seed);
+	void FinishGeneration(FDungeonGenerationResult& result);
+	void SpawnInstancedMeshes(const FDungeonMeshInstances& meshes, FDungeonGenerationReport& report);
+	void UpdateInstancedMeshes(const TArray<int>& dirtyNodeIDs, FDungeonGenerationReport& report);
+	void CopyGeneratedRooms();
+	void WriteGenerationReport(const FDungeonGenerationReport& report, const TCHAR* fileName) const;
 	void DrawDebugTiles(float timeDrawn);
 	void ResetDungeon();
-	FVector GetRandomPointInCircle();
-	bool AreRoomsOverlapping(const FRoom& roomA, const FRoom& roomB, float margin) const;
-	FTileNode* GetNodeFromPosition(const FVector& pos);
-	TArray<FTileNode*> GetPathAStar(FTileNode* startNode, FTileNode* endNode);
-	float GetHeuristicCost(FTileNode* startNode, FTileNode* endNode);
-	bool IsPositionInGrid(const FVector& pos) const;
-	bool IsNodeTileAndDoorFacingSameDirection(FTileNode* node, FTileNode* doorNode) const;
 
 public:
 	// Called every frame